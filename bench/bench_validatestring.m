@@ -0,0 +1,222 @@
+## Copyright (C) 2018-2018 Gene Harvey
+##
+## This file is part of Octave.
+##
+## Octave is free software: you can redistribute it and/or modify it
+## under the terms of the GNU General Public License as published by
+## the Free Software Foundation, either version 3 of the License, or
+## (at your option) any later version.
+##
+## Octave is distributed in the hope that it will be useful, but
+## WITHOUT ANY WARRANTY; without even the implied warranty of
+## MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+## GNU General Public License for more details.
+##
+## You should have received a copy of the GNU General Public License
+## along with Octave; see the file COPYING.  If not, see
+## <https://www.gnu.org/licenses/>.
+
+## -*- texinfo -*-
+## @deftypefn  {} {} bench_validatestring ()
+## @deftypefnx {} {} bench_validatestring (@var{outfile})
+## Time the m-file, oct-file and built-in versions of @code{validatestring}.
+##
+## Three workloads are run: line property names as passed to plot
+## functions, optimset parameter names as matched by inputParser-style
+## code, and a dictionary of 60000 synthetic gene symbols.  Each variant is
+## also timed on a one element list, which measures the cost of calling it
+## and checking its arguments.  The matching cost is the difference.
+##
+## The m-file is the @file{validatestring.m} that ships with Octave, copied
+## under another name since the oct-file shadows it.  The oct-file is
+## @file{validatestring.oct} from the parent directory of this script,
+## timed with and without its cache.  The built-in version is timed only if
+## Octave was built with @file{validatestring.cc.static}.
+##
+## If @var{outfile} is given, the results are also written to it, one line
+## per workload and variant.
+## @end deftypefn
+
+function bench_validatestring (outfile)
+
+  min_time = 0.2;
+  rootdir = fileparts (fileparts (mfilename ("fullpath")));
+
+  plot_props = {"clipping", "color", "displayname", "hittest", "linejoin", ...
+                "linestyle", "linewidth", "marker", "markeredgecolor", ...
+                "markerfacecolor", "markersize", "parent", "tag", ...
+                "userdata", "visible", "xdata", "ydata", "zdata"};
+  plot_queries = {"color", "LineWidth", "lines", "marker", "markerf", ...
+                  "MarkerSize", "disp", "vis", "x", "tag"};
+
+  params = {"AutoScaling", "ComplexEqn", "Display", "FinDiffType", ...
+            "FunValCheck", "GradObj", "Jacobian", "MaxFunEvals", ...
+            "MaxIter", "OutputFcn", "TolFun", "TolX", "TypicalX", "Updating"};
+  param_queries = {"tolf", "TolX", "maxiter", "MaxFun", "disp", ...
+                   "gradobj", "outputfcn", "jac"};
+
+  genes = gene_symbols (60000);
+  gene_queries = genes(round (linspace (1, numel (genes), 200)));
+  gene_queries(1:2:end) = lower (gene_queries(1:2:end));
+
+  workloads = struct ("name", {"plot", "inputParser", "genes"},
+                      "strarray", {plot_props, params, genes},
+                      "queries", {plot_queries, param_queries, gene_queries});
+
+  variants = {};
+
+  tmpdir = tempname ();
+  mfile = fullfile (fileparts (which ("strtrim")), "validatestring.m");
+  if (exist (mfile, "file"))
+    mkdir (tmpdir);
+    code = fileread (mfile);
+    code = regexprep (code, '(function\s+\w+\s*=\s*)validatestring\>',
+                      "$1validatestring_mfile", "once");
+    fid = fopen (fullfile (tmpdir, "validatestring_mfile.m"), "w");
+    fputs (fid, code);
+    fclose (fid);
+    addpath (tmpdir);
+    variants(end+1,:) = {"m-file", @validatestring_mfile, []};
+  else
+    warning ("bench_validatestring: validatestring.m not found, skipping it\n");
+  endif
+
+  addpath (rootdir);
+  unwind_protect
+    if (! strcmp (which ("validatestring"),
+                  fullfile (rootdir, "validatestring.oct")))
+      error ("bench_validatestring: build validatestring.oct in %s first",
+             rootdir);
+    endif
+    ## The result of every variant for every query is compared with the
+    ## oct-file's before it is timed.
+    for i = 1:numel (workloads)
+      w = workloads(i);
+      workloads(i).expected = cellfun (@(str) validatestring (str, w.strarray),
+                                       w.queries, "uniformoutput", false);
+    endfor
+
+    cache_size = validatestring_cache_size ();
+    variants(end+1,:) = {"oct", @validatestring, cache_size};
+    variants(end+1,:) = {"oct-nocache", @validatestring, 0};
+
+    results = {};
+    for i = 1:rows (variants)
+      results = [results; run_variant(variants(i,:), workloads, min_time)];
+    endfor
+    validatestring_cache_size (cache_size);
+  unwind_protect_cleanup
+    rmpath (rootdir);
+  end_unwind_protect
+
+  ## A validatestring.m on the path would shadow the built-in function, so
+  ## it is called through builtin.
+  if (any (strcmp ("validatestring", __builtins__ ())))
+    builtin_fcn = @(str, strarray) builtin ("validatestring", str, strarray);
+    results = [results; run_variant({"builtin", builtin_fcn, []},
+                                    workloads, min_time)];
+  else
+    printf ("validatestring is not a built-in function, skipping it\n");
+  endif
+
+  if (exist (tmpdir, "dir"))
+    rmpath (tmpdir);
+    confirm_recursive_rmdir (false, "local");
+    rmdir (tmpdir, "s");
+  endif
+
+  printf ("\n%-12s %-12s %8s %10s %10s %10s\n", "workload", "variant",
+          "entries", "us/call", "dispatch", "matching");
+  for i = 1:rows (results)
+    printf ("%-12s %-12s %8d %10.2f %10.2f %10.2f\n", results{i,:});
+  endfor
+
+  if (nargin > 0)
+    fid = fopen (outfile, "w");
+    if (fid < 0)
+      error ("bench_validatestring: unable to open %s", outfile);
+    endif
+    fprintf (fid, "# workload variant entries us_per_call dispatch_us matching_us\n");
+    for i = 1:rows (results)
+      fprintf (fid, "%s %s %d %.3f %.3f %.3f\n", results{i,:});
+    endfor
+    fclose (fid);
+  endif
+
+endfunction
+
+## One row per workload: name, variant, entries, us/call, dispatch and
+## matching.  The result for every query is checked against the oct-file's
+## first, so a variant that raises an error or returns another string is
+## caught before it is timed.
+
+function results = run_variant (variant, workloads, min_time)
+
+  [name, fcn, cache_size] = variant{:};
+  if (! isempty (cache_size))
+    validatestring_cache_size (cache_size);
+    validatestring_cache_clear ();
+  endif
+
+  dispatch = time_calls (fcn, {"x"}, {"x"}, min_time);
+
+  results = cell (numel (workloads), 6);
+  for i = 1:numel (workloads)
+    w = workloads(i);
+    for j = 1:numel (w.queries)
+      if (! strcmp (fcn (w.queries{j}, w.strarray), w.expected{j}))
+        error ("bench_validatestring: %s validates '%s' differently in %s",
+               name, w.queries{j}, w.name);
+      endif
+    endfor
+    t = time_calls (fcn, w.queries, w.strarray, min_time);
+    results(i,:) = {w.name, name, numel(w.strarray), 1e6 * t, 1e6 * dispatch,
+                    1e6 * (t - dispatch)};
+  endfor
+
+endfunction
+
+## Time per call of FCN over QUERIES, repeated until MIN_TIME has passed.
+
+function t = time_calls (fcn, queries, strarray, min_time)
+
+  for i = 1:numel (queries)
+    fcn (queries{i}, strarray);
+  endfor
+
+  nq = numel (queries);
+  reps = 1;
+  do
+    reps *= 2;
+    t0 = tic ();
+    for k = 1:reps
+      for i = 1:nq
+        fcn (queries{i}, strarray);
+      endfor
+    endfor
+    elapsed = toc (t0);
+  until (elapsed >= min_time)
+
+  t = elapsed / (reps * nq);
+
+endfunction
+
+## N unique gene-like symbols: two to five capital letters, most followed
+## by a number, sorted as a gene dictionary would be.
+
+function genes = gene_symbols (n)
+
+  rand ("state", 42);
+  m = round (1.5 * n);
+  genes = cell (m, 1);
+  for i = 1:m
+    s = char ("A" + floor (26 * rand (1, 2 + floor (4 * rand ()))));
+    if (rand () < 0.7)
+      s = sprintf ("%s%d", s, 1 + floor (30 * rand ()));
+    endif
+    genes{i} = s;
+  endfor
+  genes = unique (genes);
+  genes = genes(1:n);
+
+endfunction
@@ -0,0 +1,475 @@
+/*
+
+Copyright (C) 2018-2018 Gene Harvey
+
+This file is part of Octave.
+
+Octave is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Octave is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Octave; see the file COPYING.  If not, see
+<https://www.gnu.org/licenses/>.
+
+*/
+
+// Benchmark of the matching engine alone, without Octave, for profiling.
+// For each size of the list of strings it reports, for the linear scan on
+// one thread and on one thread per core and for each kind of index, the
+// time to build the index, its size per string, and the time per lookup
+// for queries that match, miss and are ambiguous.  The scan reads the
+// strings where they are, each in its own heap block, and arena-scan reads
+// a validatestring_arena copy of them.  The strings are generated as in
+// bench/validatestring-bench.
+//
+// On Linux the cache misses per lookup of the matching query are also
+// counted, if the kernel gives access to the hardware counters, and are
+// reported as -1 otherwise.
+//
+// It then reports the same for MAX_SIZE names that share long prefixes,
+// like those of the parameters of a large model, and the time per lookup
+// in a short list of options fixed at compile time, for the scan, the trie
+// and validatestring_fixed.  The results of validatestring_fixed are
+// checked against validatestring_scan first, and some of them at compile
+// time.
+//
+// It then validates one million queries against 100000 strings as a batch,
+// with 1 to N threads, where N is the number of cores or NTHREADS.
+//
+//   make bench/engine-bench
+//   bench/engine-bench [max_size [min_time_ms [nthreads]]]
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#if defined (__linux__)
+#  include <linux/perf_event.h>
+#  include <sys/ioctl.h>
+#  include <sys/syscall.h>
+#  include <unistd.h>
+#endif
+
+#include "validatestring-engine.h"
+#include "validatestring-fixed.h"
+
+// Results of validatestring_fixed, computed by the compiler: a unique
+// prefix, an exact match that is also a prefix of other strings, ambiguous
+// prefixes, no match, the empty string, and equal strings.
+
+static constexpr validatestring_fixed fixed_methods ("nearest", "previous",
+                                                     "next", "linear",
+                                                     "spline", "pchip",
+                                                     "cubic", "makima");
+
+static_assert (fixed_methods.lookup ("l") == 3);
+static_assert (fixed_methods.lookup ("SPL") == 4);
+static_assert (fixed_methods.lookup ("NEXT") == 2);
+static_assert (fixed_methods.lookup ("ne") == validatestring_ambiguous);
+static_assert (fixed_methods.lookup ("p") == validatestring_ambiguous);
+static_assert (fixed_methods.lookup ("linears") == validatestring_no_match);
+static_assert (fixed_methods.lookup ("x") == validatestring_no_match);
+static_assert (fixed_methods.lookup ("") == validatestring_ambiguous);
+
+static constexpr validatestring_fixed fixed_octave ("octave", "Oct",
+                                                    "octopus", "octaves",
+                                                    "OCTAVE");
+
+static_assert (fixed_octave.lookup ("oct") == 1);
+static_assert (fixed_octave.lookup ("o") == 1);
+static_assert (fixed_octave.lookup ("octa") == 0);
+static_assert (fixed_octave.lookup ("Octave") == 0);
+static_assert (fixed_octave.lookup ("octav") == 0);
+static_assert (fixed_octave.lookup ("octo") == 2);
+static_assert (fixed_octave.lookup ("octaves") == 3);
+static_assert (fixed_octave.lookup ("octopuses") == validatestring_no_match);
+static_assert (fixed_octave.lookup ("") == 1);
+
+static constexpr validatestring_fixed fixed_single ("");
+
+static_assert (fixed_single.lookup ("") == 0);
+static_assert (fixed_single.lookup ("a") == validatestring_no_match);
+
+// Check validatestring_fixed against validatestring_scan for every prefix
+// of its strings, in both cases, and for each of them followed by "x".
+
+template <typename Fixed>
+static void
+check_fixed (const Fixed& fixed)
+{
+  std::vector<std::string_view> views;
+  for (std::size_t i = 0; i < fixed.size (); i++)
+    views.push_back (fixed(i));
+  validatestring_string_views strs (views);
+
+  for (std::string_view s : views)
+    for (std::size_t len = 0; len <= s.length (); len++)
+      {
+        std::string lower (s.substr (0, len));
+        std::string upper (lower);
+        std::transform (upper.begin (), upper.end (), upper.begin (),
+                        [] (unsigned char c) { return std::toupper (c); });
+
+        for (const std::string& q : { lower, upper, lower + 'x' })
+          {
+            if (fixed.lookup (q) != validatestring_scan (q, strs))
+              {
+                std::fprintf (stderr, "validatestring_fixed: wrong result "
+                              "for '%s'\n", q.c_str ());
+                std::exit (1);
+              }
+          }
+      }
+}
+
+static volatile validatestring_match sink;
+
+static const std::size_t word_len = 24;
+
+static std::string
+make_word (std::size_t i, std::size_t id_len, unsigned int& seed)
+{
+  std::string w (word_len, 'a');
+  for (std::size_t j = id_len; j-- > 0; i /= 26)
+    w[j] = 'a' + i % 26;
+  for (std::size_t j = id_len; j < word_len; j++)
+    {
+      seed = seed * 1103515245u + 12345u;
+      w[j] = 'a' + (seed >> 16) % 26;
+    }
+  return w;
+}
+
+static std::unique_ptr<validatestring_index>
+make_index (const std::string& kind, const validatestring_strings& strs)
+{
+  if (kind == "trie")
+    return std::make_unique<validatestring_trie> (strs);
+  else if (kind == "sorted")
+    return std::make_unique<validatestring_sorted_index> (strs);
+  else if (kind == "double-array")
+    return std::make_unique<validatestring_dat_index> (strs);
+  else if (kind == "front-coded")
+    return std::make_unique<validatestring_front_coded_index> (strs);
+  else if (kind == "bit-sliced")
+    return std::make_unique<validatestring_bitslice_index> (strs);
+  else
+    return std::make_unique<validatestring_packed_index> (strs);
+}
+
+// Time per call of FCN, repeated until MIN_TIME_NS has passed.
+
+template <typename F>
+static double
+time_ns (double min_time_ns, F fcn)
+{
+  std::size_t ncalls = 0;
+  double elapsed = 0;
+
+  for (std::size_t batch = 1; elapsed < min_time_ns; batch *= 2)
+    {
+      auto start = std::chrono::steady_clock::now ();
+      for (std::size_t k = 0; k < batch; k++)
+        sink = fcn ();
+      auto stop = std::chrono::steady_clock::now ();
+      elapsed += std::chrono::duration<double, std::nano> (stop - start)
+                   .count ();
+      ncalls += batch;
+    }
+
+  return elapsed / ncalls;
+}
+
+// Cache misses per call of FCN over NCALLS calls, or -1 if they cannot be
+// counted.
+
+template <typename F>
+static double
+cache_misses (std::size_t ncalls, F fcn)
+{
+#if defined (__linux__)
+  perf_event_attr attr {};
+  attr.size = sizeof (attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = PERF_COUNT_HW_CACHE_MISSES;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+
+  int fd = syscall (SYS_perf_event_open, &attr, 0, -1, -1, 0);
+  if (fd >= 0)
+    {
+      ioctl (fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl (fd, PERF_EVENT_IOC_ENABLE, 0);
+      for (std::size_t k = 0; k < ncalls; k++)
+        sink = fcn ();
+      ioctl (fd, PERF_EVENT_IOC_DISABLE, 0);
+
+      long long count = 0;
+      bool ok = (read (fd, &count, sizeof (count)) == sizeof (count));
+      close (fd);
+      if (ok)
+        return static_cast<double> (count) / ncalls;
+    }
+#endif
+
+  return -1;
+}
+
+int
+main (int argc, char **argv)
+{
+  std::size_t max_size = (argc > 1 ? std::atol (argv[1]) : 1000000);
+  double min_time_ns = 1e6 * (argc > 2 ? std::atof (argv[2]) : 20);
+  std::size_t max_threads = (argc > 3 ? std::atol (argv[3])
+                             : std::thread::hardware_concurrency ());
+
+  std::printf ("# size engine build_ns bytes_per_string hit_ns miss_ns"
+               " ambiguous_ns hit_cache_misses\n");
+
+  for (std::size_t n = 10; n <= max_size; n *= 10)
+    {
+      std::size_t id_len = 1;
+      for (std::size_t m = 26; m < n; m *= 26)
+        id_len++;
+
+      unsigned int seed = 1;
+      std::vector<std::string> words;
+      for (std::size_t i = 0; i < n; i++)
+        words.push_back (make_word (i, id_len, seed));
+
+      // An extra sibling of the middle word, differing in its last letter,
+      // makes its prefixes ambiguous.
+      std::string target = words[n / 2];
+      words.push_back (target);
+      words.back ().back () = (target.back () == 'z' ? 'y' : 'z');
+
+      std::vector<std::string_view> views (words.begin (), words.end ());
+      validatestring_string_views strs (views);
+
+      std::string miss = target;
+      miss.back () = '0';
+
+      std::string queries[] = { target, miss, target.substr (0, word_len - 1) };
+
+      // As many calls as are timed.
+      auto calls = [min_time_ns] (double ns)
+        { return std::max<std::size_t> (1, min_time_ns / ns); };
+
+      for (const char *engine : { "scan", "pscan", "arena-scan", "trie",
+                                  "sorted",
+                                  "double-array", "front-coded",
+                                  "bit-sliced", "packed" })
+        {
+          std::string name = engine;
+          double build_ns = 0;
+          double bytes = 0;
+          double lookup_ns[3];
+          double misses;
+
+          if (name == "scan" || name == "pscan")
+            {
+              std::size_t nthreads = (name == "scan" ? 1 : 0);
+              for (int k = 0; k < 3; k++)
+                {
+                  std::string_view query = queries[k];
+                  lookup_ns[k] = time_ns (min_time_ns, [&] (void)
+                    { return validatestring_scan (query, strs, nthreads); });
+                }
+              misses = cache_misses (calls (lookup_ns[0]), [&] (void)
+                { return validatestring_scan (queries[0], strs, nthreads); });
+            }
+          else if (name == "arena-scan")
+            {
+              build_ns = time_ns (min_time_ns, [&] (void)
+                {
+                  return static_cast<validatestring_match>
+                           (validatestring_arena (strs).size ());
+                });
+
+              validatestring_arena arena (strs);
+              bytes = static_cast<double> (arena.byte_size ()) / strs.size ();
+
+              for (int k = 0; k < 3; k++)
+                {
+                  std::string_view query = queries[k];
+                  lookup_ns[k] = time_ns (min_time_ns, [&] (void)
+                    { return validatestring_scan (query, arena); });
+                }
+              misses = cache_misses (calls (lookup_ns[0]), [&] (void)
+                { return validatestring_scan (queries[0], arena); });
+            }
+          else
+            {
+              build_ns = time_ns (min_time_ns, [&] (void)
+                {
+                  return static_cast<validatestring_match>
+                           (make_index (name, strs)->size ());
+                });
+
+              std::unique_ptr<validatestring_index> index
+                = make_index (name, strs);
+              bytes = static_cast<double> (index->byte_size ()) / strs.size ();
+
+              for (int k = 0; k < 3; k++)
+                {
+                  std::string_view query = queries[k];
+                  lookup_ns[k] = time_ns (min_time_ns, [&] (void)
+                    { return index->lookup (query); });
+                }
+              misses = cache_misses (calls (lookup_ns[0]), [&] (void)
+                { return index->lookup (queries[0]); });
+            }
+
+          std::printf ("%zu %s %.1f %.1f %.1f %.1f %.1f %.1f\n", n, engine,
+                       build_ns, bytes, lookup_ns[0], lookup_ns[1],
+                       lookup_ns[2], misses);
+        }
+    }
+
+  {
+    std::vector<std::string> names;
+    for (std::size_t i = 0; i < max_size; i++)
+      {
+        static const char *groups[] = { "Alpha", "Beta", "Gamma", "Delta" };
+        names.push_back ("Parameter_Group_" + std::string (groups[i % 4])
+                         + '_' + std::to_string (i / 4));
+      }
+
+    std::vector<std::string_view> views (names.begin (), names.end ());
+    validatestring_string_views strs (views);
+
+    std::string queries[] = { names[max_size / 2], "Parameter_Group_Omega",
+                              "Parameter_Group_Beta_1" };
+
+    std::printf ("\n# prefixed names: size engine build_ns bytes_per_string"
+                 " hit_ns miss_ns ambiguous_ns\n");
+
+    for (const char *engine : { "trie", "sorted", "double-array",
+                                "front-coded" })
+      {
+        std::string name = engine;
+        double build_ns = time_ns (min_time_ns, [&] (void)
+          {
+            return static_cast<validatestring_match>
+                     (make_index (name, strs)->size ());
+          });
+
+        std::unique_ptr<validatestring_index> index = make_index (name, strs);
+        double bytes = static_cast<double> (index->byte_size ()) / max_size;
+
+        double lookup_ns[3];
+        for (int k = 0; k < 3; k++)
+          {
+            std::string_view query = queries[k];
+            lookup_ns[k] = time_ns (min_time_ns, [&] (void)
+              { return index->lookup (query); });
+          }
+
+        std::printf ("%zu %s %.1f %.1f %.1f %.1f %.1f\n", max_size, engine,
+                     build_ns, bytes, lookup_ns[0], lookup_ns[1],
+                     lookup_ns[2]);
+      }
+  }
+
+  {
+    const auto& methods = fixed_methods;
+
+    check_fixed (fixed_methods);
+    check_fixed (fixed_octave);
+    check_fixed (fixed_single);
+
+    std::vector<std::string_view> views;
+    for (std::size_t i = 0; i < methods.size (); i++)
+      views.push_back (methods(i));
+    validatestring_string_views strs (views);
+    validatestring_trie trie (strs);
+
+    std::string_view queries[] = { "linear", "Spline", "p", "lin", "c",
+                                   "nearest", "pc", "MAKIMA" };
+
+    std::printf ("\n# fixed list: engine ns_per_lookup\n");
+
+    auto report = [&] (const char *engine, auto fcn)
+      {
+        std::printf ("%s %.1f\n", engine, time_ns (min_time_ns, [&] (void)
+          {
+            validatestring_match m = 0;
+            for (std::string_view q : queries)
+              m += fcn (q);
+            return m;
+          }) / std::size (queries));
+      };
+
+    report ("scan", [&] (std::string_view q)
+      { return validatestring_scan (q, strs); });
+    report ("trie", [&] (std::string_view q) { return trie.lookup (q); });
+    report ("fixed", [&] (std::string_view q) { return methods.lookup (q); });
+  }
+
+  // Half of the queries are hits, a quarter are prefixes of many strings,
+  // and a quarter miss.
+
+  std::size_t nwords = 100000;
+  std::size_t nqueries = 1000000;
+  std::size_t id_len = 4;
+
+  unsigned int seed = 1;
+  std::vector<std::string> words;
+  for (std::size_t i = 0; i < nwords; i++)
+    words.push_back (make_word (i, id_len, seed));
+
+  std::vector<std::string> queries;
+  for (std::size_t i = 0; i < nqueries; i++)
+    {
+      std::string q = words[(i * 7919) % nwords];
+      if (i % 4 == 2)
+        q.resize (id_len - 1);
+      else if (i % 4 == 3)
+        q.back () = '0';
+      queries.push_back (q);
+    }
+
+  std::vector<std::string_view> word_views (words.begin (), words.end ());
+  std::vector<std::string_view> query_views (queries.begin (),
+                                             queries.end ());
+  validatestring_string_views word_strs (word_views);
+  validatestring_string_views query_strs (query_views);
+
+  validatestring_trie trie (word_strs);
+  std::vector<validatestring_match> results (nqueries);
+
+  std::printf ("\n# threads batch_ns_per_query speedup\n");
+
+  double base_ns = 0;
+  for (std::size_t t = 1; t <= std::max<std::size_t> (1, max_threads); t++)
+    {
+      double ns = time_ns (min_time_ns, [&] (void)
+        {
+          validatestring_lookup_all (trie, query_strs, results.data (), t);
+          return results[0];
+        }) / nqueries;
+
+      if (t == 1)
+        base_ns = ns;
+
+      std::printf ("%zu %.2f %.2f\n", t, ns, base_ns / ns);
+    }
+
+  return 0;
+}
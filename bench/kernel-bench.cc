@@ -0,0 +1,141 @@
+/*
+
+Copyright (C) 2018-2018 Gene Harvey
+
+This file is part of Octave.
+
+Octave is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Octave is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Octave; see the file COPYING.  If not, see
+<https://www.gnu.org/licenses/>.
+
+*/
+
+// Microbenchmark of the validatestring prefix kernels against the
+// octave::string::strncmpi loop they replace.  Every candidate is compared
+// with the first N characters of a query, half of the candidates matching
+// in mixed case and the others differing in their last compared character.
+//
+//   make bench/kernel-bench && bench/kernel-bench [ncands [reps]]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <octave/oct-string.h>
+
+#include "validatestring-kernel.h"
+
+static volatile std::size_t sink;
+
+template <typename F>
+static double
+time_ns (std::size_t ncands, int reps, F fcn)
+{
+  auto start = std::chrono::steady_clock::now ();
+  std::size_t nmatches = 0;
+  for (int r = 0; r < reps; r++)
+    nmatches += fcn ();
+  auto stop = std::chrono::steady_clock::now ();
+  sink = nmatches;
+  return (std::chrono::duration<double, std::nano> (stop - start).count ()
+          / (static_cast<double> (ncands) * reps));
+}
+
+int
+main (int argc, char **argv)
+{
+  std::size_t ncands = (argc > 1 ? std::atol (argv[1]) : 10000);
+  int reps = (argc > 2 ? std::atoi (argv[2]) : 200);
+
+  struct variant
+  {
+    const char *name;
+    validatestring_prefix_fcn fcn;
+    bool supported;
+  };
+
+  std::vector<variant> variants = {
+    { "scalar", validatestring_prefix_scalar, true },
+#if defined (VALIDATESTRING_X86_DISPATCH)
+    { "sse2", validatestring_prefix_sse2, __builtin_cpu_supports ("sse2") != 0 },
+    { "avx2", validatestring_prefix_avx2, __builtin_cpu_supports ("avx2") != 0 },
+    { "avx512", validatestring_prefix_avx512,
+      __builtin_cpu_supports ("avx512bw") != 0 },
+#endif
+  };
+
+  std::printf ("# ns per candidate, %zu candidates x %d repetitions\n",
+               ncands, reps);
+  std::printf ("%6s %10s", "qlen", "strncmpi");
+  for (const auto& v : variants)
+    if (v.supported)
+      std::printf (" %10s", v.name);
+  std::printf (" %10s\n", "dispatch");
+
+  std::mt19937 gen (42);
+  std::uniform_int_distribution<int> letter (0, 25);
+
+  for (std::size_t qlen : { 1, 4, 8, 16, 32, 64, 128, 256 })
+    {
+      std::string query;
+      for (std::size_t j = 0; j < qlen; j++)
+        query += static_cast<char> ('a' + letter (gen));
+
+      std::vector<std::string> cands (ncands);
+      for (std::size_t i = 0; i < ncands; i++)
+        {
+          std::string& c = cands[i];
+          for (std::size_t j = 0; j < qlen; j++)
+            c += static_cast<char> (letter (gen) < 13 ? query[j]
+                                                      : query[j] - 'a' + 'A');
+          // The next letter of the alphabet, whatever the case of C.
+          if (i % 2)
+            c.back () = 'a' + (query[qlen-1] - 'a' + 1) % 26;
+          c += "_suffix";
+        }
+
+      std::printf ("%6zu", qlen);
+
+      std::printf (" %10.2f", time_ns (ncands, reps, [&] (void)
+        {
+          std::size_t n = 0;
+          for (const auto& c : cands)
+            n += octave::string::strncmpi (query, c, qlen);
+          return n;
+        }));
+
+      auto kernel = [&] (validatestring_prefix_fcn fcn)
+        {
+          return time_ns (ncands, reps, [&] (void)
+            {
+              std::string folded = validatestring_folded (query);
+              std::size_t n = 0;
+              for (const auto& c : cands)
+                n += (c.length () >= qlen && fcn (folded.data (), c.data (),
+                                                  qlen));
+              return n;
+            });
+        };
+
+      for (const auto& v : variants)
+        if (v.supported)
+          std::printf (" %10.2f", kernel (v.fcn));
+
+      std::printf (" %10.2f\n", kernel (validatestring_prefix_folded));
+    }
+
+  return 0;
+}
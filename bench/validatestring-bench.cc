@@ -0,0 +1,394 @@
+/*
+
+Copyright (C) 2018-2018 Gene Harvey
+
+This file is part of Octave.
+
+Octave is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Octave is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Octave; see the file COPYING.  If not, see
+<https://www.gnu.org/licenses/>.
+
+*/
+
+// Benchmark of validatestring, called directly as Fvalidatestring from an
+// embedded interpreter so that only the function itself is measured.
+//
+//   bench/validatestring-bench [options]
+//
+//   --output FILE        write results to FILE (default bench_output.txt)
+//   --baseline FILE      compare with the results saved in FILE
+//   --tolerance X        allowed relative slowdown (default 0.10)
+//   --max-size N         largest STRARRAY to test (default 1000000)
+//   --min-time MS        time spent on each case (default 20)
+//
+// The sweep covers the size of STRARRAY, the length of STR, whether STR
+// matches, misses or is ambiguous, and the case of STR, for the linear
+// scan, the cache and each kind of compiled index.  Every element of
+// STRARRAY has 24 lower case letters and starts with its index in base 26,
+// so a prefix as long as that index is unique.
+// Misses and ambiguous matches are requested with three outputs so that
+// they measure matching, not error handling.
+//
+// Each output line holds the case (engine, size, qlen, kind, case) followed
+// by ns/call, calls/sec and allocations/call.  Each compiled index is built
+// once for every STRARRAY, and the time that takes is given by the case
+// "build" in place of the case of STR.  With --baseline the exit
+// status is 1 if any case is slower than the baseline by more than the
+// tolerance.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+
+#include <octave/oct.h>
+#include <octave/interpreter.h>
+
+// The engines are internal to validatestring-octave.cc, so it is compiled
+// into the benchmark with validatestring.cc rather than loaded as an
+// oct-file.
+#include "validatestring.cc"
+#include "validatestring-octave.cc"
+
+// Threads that search a large STRARRAY also allocate, so the count is
+// atomic.
+
+static std::atomic<std::size_t> alloc_count (0);
+
+void *
+operator new (std::size_t n)
+{
+  alloc_count.fetch_add (1, std::memory_order_relaxed);
+  if (void *p = std::malloc (n ? n : 1))
+    return p;
+  throw std::bad_alloc ();
+}
+
+void
+operator delete (void *p) noexcept
+{
+  std::free (p);
+}
+
+void
+operator delete (void *p, std::size_t) noexcept
+{
+  std::free (p);
+}
+
+static const std::size_t word_len = 24;
+
+static std::string
+make_word (std::size_t i, std::size_t id_len, unsigned int& seed)
+{
+  std::string w (word_len, 'a');
+  for (std::size_t j = id_len; j-- > 0; i /= 26)
+    w[j] = 'a' + i % 26;
+  for (std::size_t j = id_len; j < word_len; j++)
+    {
+      seed = seed * 1103515245u + 12345u;
+      w[j] = 'a' + (seed >> 16) % 26;
+    }
+  return w;
+}
+
+static std::string
+apply_case (std::string s, const std::string& pattern)
+{
+  for (std::size_t j = 0; j < s.length (); j++)
+    {
+      if (pattern == "upper" || (pattern == "mixed" && j % 2 == 0))
+        s[j] = s[j] - 'a' + 'A';
+    }
+  return s;
+}
+
+struct bench_result
+{
+  double ns_per_call;
+  double calls_per_sec;
+  double allocs_per_call;
+};
+
+static bench_result
+run_case (const octave_value_list& args, int nargout, double min_time_ns)
+{
+  // Warm up, which also lets the cache build its index.
+  for (int k = 0; k < 3; k++)
+    Fvalidatestring (args, nargout);
+
+  std::size_t ncalls = 0;
+  std::size_t nallocs = 0;
+  double elapsed = 0;
+
+  for (std::size_t batch = 1; elapsed < min_time_ns; batch *= 2)
+    {
+      std::size_t allocs_before = alloc_count.load ();
+      auto start = std::chrono::steady_clock::now ();
+      for (std::size_t k = 0; k < batch; k++)
+        Fvalidatestring (args, nargout);
+      auto stop = std::chrono::steady_clock::now ();
+      nallocs += alloc_count.load () - allocs_before;
+      elapsed += std::chrono::duration<double, std::nano> (stop - start)
+                   .count ();
+      ncalls += batch;
+    }
+
+  return { elapsed / ncalls, 1e9 * ncalls / elapsed,
+           static_cast<double> (nallocs) / ncalls };
+}
+
+// Write the result R of case KEY to OS and to the terminal, compared with
+// its time in BASELINE if there is one.  Return true if R is slower than
+// that by more than TOLERANCE.
+
+static bool
+report (std::ostream& os, const std::string& key, const bench_result& r,
+        const std::map<std::string, double>& baseline, double tolerance)
+{
+  bool regression = false;
+
+  char line[256];
+  std::snprintf (line, sizeof (line), "%s %.1f %.1f %.2f", key.c_str (),
+                 r.ns_per_call, r.calls_per_sec, r.allocs_per_call);
+  os << line << std::endl;
+  std::cout << line;
+
+  auto it = baseline.find (key);
+  if (it != baseline.end ())
+    {
+      double ratio = r.ns_per_call / it->second;
+      std::printf ("  (%+.1f%%)", 100 * (ratio - 1));
+      if (ratio > 1 + tolerance)
+        {
+          std::printf ("  REGRESSION");
+          regression = true;
+        }
+    }
+  std::printf ("\n");
+
+  return regression;
+}
+
+static std::map<std::string, double>
+read_baseline (const std::string& file)
+{
+  std::map<std::string, double> baseline;
+  std::ifstream is (file);
+  std::string line;
+
+  if (! is)
+    {
+      std::cerr << "validatestring-bench: unable to read " << file << "\n";
+      std::exit (2);
+    }
+
+  while (std::getline (is, line))
+    {
+      if (line.empty () || line[0] == '#')
+        continue;
+      std::istringstream fields (line);
+      std::string engine, size, qlen, kind, pattern;
+      double ns;
+      if (fields >> engine >> size >> qlen >> kind >> pattern >> ns)
+        baseline[engine + ' ' + size + ' ' + qlen + ' ' + kind + ' '
+                 + pattern] = ns;
+    }
+
+  return baseline;
+}
+
+int
+main (int argc, char **argv)
+{
+  std::string output = "bench_output.txt";
+  std::string baseline_file;
+  double tolerance = 0.10;
+  std::size_t max_size = 1000000;
+  double min_time_ns = 20e6;
+
+  for (int i = 1; i < argc; i++)
+    {
+      std::string opt = argv[i];
+      if (i + 1 >= argc)
+        {
+          std::cerr << "validatestring-bench: missing value for " << opt
+                    << "\n";
+          return 2;
+        }
+      std::string val = argv[++i];
+      if (opt == "--output")
+        output = val;
+      else if (opt == "--baseline")
+        baseline_file = val;
+      else if (opt == "--tolerance")
+        tolerance = std::atof (val.c_str ());
+      else if (opt == "--max-size")
+        max_size = std::atol (val.c_str ());
+      else if (opt == "--min-time")
+        min_time_ns = 1e6 * std::atof (val.c_str ());
+      else
+        {
+          std::cerr << "validatestring-bench: unknown option " << opt << "\n";
+          return 2;
+        }
+    }
+
+  octave::interpreter interp;
+
+  if (interp.execute () != 0)
+    {
+      std::cerr << "validatestring-bench: unable to start interpreter\n";
+      return 2;
+    }
+
+  octave_validatestring_index::register_type (interp.get_type_info ());
+
+  std::ofstream os (output);
+  os << "# validatestring benchmark\n"
+     << "# engine size qlen kind case ns_per_call calls_per_sec"
+     << " allocs_per_call\n";
+
+  std::map<std::string, double> baseline;
+  if (! baseline_file.empty ())
+    baseline = read_baseline (baseline_file);
+
+  int nregressions = 0;
+
+  for (std::size_t n = 10; n <= max_size; n *= 10)
+    {
+      std::size_t id_len = 1;
+      for (std::size_t m = 26; m < n; m *= 26)
+        id_len++;
+
+      unsigned int seed = 1;
+      Cell strarray (dim_vector (1, n + 1));
+      for (std::size_t i = 0; i < n; i++)
+        strarray(i) = octave_value (make_word (i, id_len, seed));
+
+      unsigned int target_seed = 7;
+      std::string target = make_word (n / 2, id_len, target_seed);
+      strarray(n / 2) = octave_value (target);
+
+      for (const char *qlen : { "prefix", "half", "full" })
+        {
+          std::size_t len = (! std::strcmp (qlen, "prefix") ? id_len
+                             : ! std::strcmp (qlen, "half")
+                             ? (id_len + word_len) / 2 : word_len);
+
+          for (const char *kind : { "hit", "miss", "ambiguous" })
+            {
+              std::string query = target.substr (0, len);
+              std::string sibling = target;
+              int nargout = 1;
+
+              if (! std::strcmp (kind, "miss"))
+                {
+                  query.back () = '0';
+                  nargout = 3;
+                }
+              else if (! std::strcmp (kind, "ambiguous"))
+                {
+                  // A sibling that differs just after STR makes it
+                  // ambiguous.  A full length STR drops its last letter.
+                  if (len == word_len)
+                    query.pop_back ();
+                  sibling[query.length ()]
+                    = (sibling[query.length ()] == 'z' ? 'y' : 'z');
+                  nargout = 3;
+                }
+
+              // The extra last element is either a copy of the target,
+              // which changes nothing, or the ambiguous sibling.
+              strarray(n) = octave_value (sibling);
+
+              std::map<std::string, octave_value> indices;
+
+              for (const char *engine : { "trie", "sorted", "double-array",
+                                          "front-coded", "bit-sliced",
+                                          "packed" })
+                {
+                  std::size_t allocs_before = alloc_count.load ();
+                  auto start = std::chrono::steady_clock::now ();
+                  indices[engine] = octave_value
+                                      (new octave_validatestring_index
+                                         (strarray, validatestring_make_index
+                                                      (strarray, engine)));
+                  auto stop = std::chrono::steady_clock::now ();
+                  double ns = std::chrono::duration<double, std::nano>
+                                (stop - start).count ();
+
+                  std::ostringstream key;
+                  key << engine << ' ' << n << ' ' << qlen << ' ' << kind
+                      << " build";
+
+                  nregressions
+                    += report (os, key.str (),
+                               { ns, 1e9 / ns,
+                                 static_cast<double> (alloc_count.load ()
+                                                      - allocs_before) },
+                               baseline, tolerance);
+                }
+
+              for (const char *pattern : { "lower", "upper", "mixed" })
+                {
+                  octave_value ov_str (apply_case (query, pattern));
+
+                  for (const char *engine : { "scan", "cache", "trie",
+                                              "sorted", "double-array",
+                                              "front-coded", "bit-sliced",
+                                              "packed" })
+                    {
+                      octave_value_list args (2);
+                      args(0) = ov_str;
+                      if (std::strcmp (engine, "scan")
+                          && std::strcmp (engine, "cache"))
+                        args(1) = indices[engine];
+                      else
+                        args(1) = octave_value (strarray);
+
+                      Vvalidatestring_cache_size
+                        = (! std::strcmp (engine, "cache") ? 1 << 30 : 0);
+                      validatestring_cache_instance ().clear ();
+
+                      bench_result r = run_case (args, nargout, min_time_ns);
+
+                      std::ostringstream key;
+                      key << engine << ' ' << n << ' ' << qlen << ' '
+                          << kind << ' ' << pattern;
+
+                      nregressions += report (os, key.str (), r, baseline,
+                                              tolerance);
+                    }
+                }
+            }
+        }
+    }
+
+  if (! baseline_file.empty ())
+    {
+      std::printf ("%d regression%s beyond %.0f%% of %s\n", nregressions,
+                   nregressions == 1 ? "" : "s", 100 * tolerance,
+                   baseline_file.c_str ());
+      return nregressions > 0;
+    }
+
+  return 0;
+}
@@ -0,0 +1,1294 @@
+/*
+
+Copyright (C) 2018-2018 Gene Harvey
+
+This file is part of Octave.
+
+Octave is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Octave is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Octave; see the file COPYING.  If not, see
+<https://www.gnu.org/licenses/>.
+
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <future>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "validatestring-engine.h"
+
+validatestring_arena::validatestring_arena (const validatestring_strings& strs,
+                                            bool fold)
+  : m_size (strs.size ()), m_nwords (0), m_data ()
+{
+  std::size_t len = 0;
+  for (std::size_t i = 0; i < m_size; i++)
+    len += strs(i).length ();
+
+  m_nwords = (m_size + 1
+              + (len + sizeof (std::size_t) - 1) / sizeof (std::size_t));
+  m_data.reset (new std::size_t [m_nwords]);
+
+  std::size_t *offsets = m_data.get ();
+  char *p = reinterpret_cast<char *> (offsets + m_size + 1);
+  std::size_t pos = 0;
+
+  for (std::size_t i = 0; i < m_size; i++)
+    {
+      std::string_view s = strs(i);
+      offsets[i] = pos;
+      for (std::size_t j = 0; j < s.length (); j++)
+        p[pos++] = (fold ? validatestring_fold (s[j]) : s[j]);
+    }
+  offsets[m_size] = pos;
+}
+
+std::vector<std::size_t>
+validatestring_distinct_order (const validatestring_strings& folded)
+{
+  std::vector<std::size_t> order (folded.size ());
+
+  for (std::size_t i = 0; i < order.size (); i++)
+    order[i] = i;
+
+  std::stable_sort (order.begin (), order.end (),
+                    [&folded] (std::size_t a, std::size_t b)
+                    { return folded(a) < folded(b); });
+  order.erase (std::unique (order.begin (), order.end (),
+                            [&folded] (std::size_t a, std::size_t b)
+                            { return folded(a) == folded(b); }),
+               order.end ());
+
+  return order;
+}
+
+validatestring_exact_table::validatestring_exact_table
+  (const validatestring_strings& folded)
+  : m_slots ()
+{
+  std::size_t n = folded.size ();
+  if (n == 0)
+    return;
+
+  std::size_t nslots = 2;
+  while (nslots < 2 * n)
+    nslots *= 2;
+  m_slots.resize (nslots, 0);
+
+  for (std::size_t i = 0; i < n; i++)
+    {
+      std::string_view s = folded(i);
+      std::size_t k = hash (s) & (nslots - 1);
+
+      // Of equal strings, only the first is entered.
+      while (m_slots[k] && folded(m_slots[k] - 1) != s)
+        k = (k + 1) & (nslots - 1);
+      if (! m_slots[k])
+        m_slots[k] = i + 1;
+    }
+}
+
+// FNV-1a of the folded bytes of STR.
+
+std::size_t
+validatestring_exact_table::hash (std::string_view str)
+{
+  std::size_t h = 14695981039346656037ULL;
+  for (std::size_t j = 0; j < str.length (); j++)
+    h = (h ^ validatestring_fold (str[j])) * 1099511628211ULL;
+  return h ^ (h >> 32);
+}
+
+validatestring_match
+validatestring_exact_table::find (std::string_view str,
+                                  const validatestring_strings& folded) const
+{
+  std::size_t nslots = m_slots.size ();
+  if (nslots == 0)
+    return validatestring_no_match;
+
+  for (std::size_t k = hash (str) & (nslots - 1); m_slots[k];
+       k = (k + 1) & (nslots - 1))
+    {
+      std::size_t i = m_slots[k] - 1;
+      std::string_view s = folded(i);
+      if (s.length () == str.length () && validatestring_prefix (str, s))
+        return i;
+    }
+
+  return validatestring_no_match;
+}
+
+// The elements of STRS in the order given by ORDER.
+
+class validatestring_permuted : public validatestring_strings
+{
+public:
+
+  validatestring_permuted (const validatestring_strings& strs,
+                           const std::vector<std::size_t>& order)
+    : m_strs (strs), m_order (order)
+  { }
+
+  std::size_t size (void) const { return m_order.size (); }
+
+  std::string_view operator () (std::size_t i) const
+  { return m_strs(m_order[i]); }
+
+private:
+
+  const validatestring_strings& m_strs;
+
+  const std::vector<std::size_t>& m_order;
+};
+
+validatestring_trie::validatestring_trie (const validatestring_strings& strs)
+  : m_size (strs.size ())
+{
+  m_nodes.push_back (node (0));
+
+  for (std::size_t i = 0; i < m_size; i++)
+    {
+      std::string_view s = strs(i);
+      std::ptrdiff_t   n = 0;
+
+      for (std::size_t j = 0; j < s.length (); j++)
+        {
+          unsigned char key = validatestring_fold (s[j]);
+          std::ptrdiff_t child = find_child (n, key);
+          if (child < 0)
+            {
+              child = m_nodes.size ();
+              m_nodes.push_back (node (key));
+              m_nodes[child].next_sibling = m_nodes[n].first_child;
+              m_nodes[n].first_child = child;
+            }
+          n = child;
+        }
+
+      if (m_nodes[n].first_elem < 0)
+        m_nodes[n].first_elem = i;
+    }
+
+  // Children are always created after their parent, so a reverse sweep
+  // visits every subtree before its root.  If a node terminates an element
+  // then that element is the shortest match and a prefix of every other
+  // match.  Otherwise the matches continue along a single branch, or along
+  // several branches which cannot be prefixes of each other.
+
+  for (std::size_t k = m_nodes.size (); k-- > 0; )
+    {
+      node& nd = m_nodes[k];
+      if (nd.first_elem >= 0)
+        nd.answer = nd.first_elem;
+      else if (nd.first_child >= 0)
+        {
+          const node& child = m_nodes[nd.first_child];
+          nd.answer = (child.next_sibling < 0 ? child.answer
+                                              : validatestring_ambiguous);
+        }
+    }
+}
+
+std::ptrdiff_t
+validatestring_trie::find_child (std::ptrdiff_t n, unsigned char key) const
+{
+  std::ptrdiff_t child = m_nodes[n].first_child;
+  while (child >= 0 && m_nodes[child].key != key)
+    child = m_nodes[child].next_sibling;
+  return child;
+}
+
+validatestring_match
+validatestring_trie::lookup (std::string_view str) const
+{
+  std::ptrdiff_t n = 0;
+  for (std::size_t j = 0; j < str.length (); j++)
+    {
+      n = find_child (n, validatestring_fold (str[j]));
+      if (n < 0)
+        return validatestring_no_match;
+    }
+  return m_nodes[n].answer;
+}
+
+// The first 8 bytes of S as a big-endian number, padded with zeros.  Keys
+// that differ compare like the strings, and equal keys need a comparison of
+// the rest of the strings.
+
+static std::uint64_t
+validatestring_key (std::string_view s)
+{
+  std::uint64_t key = 0;
+  for (std::size_t j = 0; j < 8; j++)
+    key = (key << 8) | (j < s.length () ? static_cast<unsigned char> (s[j])
+                                        : 0);
+  return key;
+}
+
+// Number the nodes of the implicit binary tree below node K, where node K
+// has children 2K and 2K+1, in order from POS.  The sorted positions then
+// appear in RANKS in Eytzinger order.
+
+static std::size_t
+validatestring_eytzinger (std::vector<std::size_t>& ranks, std::size_t k,
+                          std::size_t pos)
+{
+  if (k < ranks.size ())
+    {
+      pos = validatestring_eytzinger (ranks, 2 * k, pos);
+      ranks[k] = pos++;
+      pos = validatestring_eytzinger (ranks, 2 * k + 1, pos);
+    }
+  return pos;
+}
+
+validatestring_sorted_index::validatestring_sorted_index
+  (const validatestring_strings& strs)
+  : m_folded (), m_index (strs.size ()), m_keys (), m_ranks ()
+{
+  std::size_t n = strs.size ();
+  validatestring_arena strs_folded (strs, true);
+
+  for (std::size_t i = 0; i < n; i++)
+    m_index[i] = i;
+
+  // Equal strings keep their original order, so the first of them comes
+  // first in its range.
+  std::stable_sort (m_index.begin (), m_index.end (),
+                    [&strs_folded] (std::size_t a, std::size_t b)
+                    { return strs_folded(a) < strs_folded(b); });
+
+  m_folded = validatestring_arena (validatestring_permuted (strs_folded,
+                                                            m_index));
+
+  m_ranks.resize (n + 1);
+  validatestring_eytzinger (m_ranks, 1, 0);
+
+  m_keys.resize (n + 1);
+  for (std::size_t k = 1; k <= n; k++)
+    m_keys[k] = validatestring_key (folded (m_ranks[k]));
+}
+
+// First sorted position for which LESS (key, pos) is false, where LESS is
+// true for the strings before the position sought.
+
+template <typename Less>
+std::size_t
+validatestring_sorted_index::search (Less less) const
+{
+  std::size_t n = m_index.size ();
+  std::size_t k = 1;
+
+  while (k <= n)
+    {
+#if defined (__GNUC__)
+      __builtin_prefetch (m_keys.data () + std::min (16 * k, n));
+#endif
+      k = 2 * k + less (m_keys[k], m_ranks[k]);
+    }
+
+  // Drop the right turns taken after the last left turn, which was at the
+  // node sought.
+  while (k & 1)
+    k >>= 1;
+  k >>= 1;
+
+  return (k == 0 ? n : m_ranks[k]);
+}
+
+validatestring_match
+validatestring_sorted_index::lookup (std::string_view str) const
+{
+  std::string   q = validatestring_folded (str);
+  std::uint64_t q_key = validatestring_key (q);
+  std::size_t   n = m_index.size ();
+
+  std::size_t lo = search ([&] (std::uint64_t key, std::size_t pos)
+    { return key != q_key ? key < q_key : folded (pos) < q; });
+
+  if (lo == n || folded (lo).substr (0, q.length ()) != q)
+    return validatestring_no_match;
+
+  // Past the strings that have the first match as a prefix.
+  std::string_view m = folded (lo);
+  std::size_t m_len = std::min<std::size_t> (m.length (), 8);
+  std::uint64_t mask = (m_len == 8 ? ~std::uint64_t (0)
+                        : ~(~std::uint64_t (0) >> (8 * m_len)));
+  std::uint64_t m_key = validatestring_key (m);
+
+  std::size_t hi = search ([&] (std::uint64_t key, std::size_t pos)
+    {
+      key &= mask;
+      if (key != m_key)
+        return key < m_key;
+      return m.length () <= 8 || folded (pos).substr (0, m.length ()) <= m;
+    });
+
+  if (hi < n && folded (hi).substr (0, q.length ()) == q)
+    return validatestring_ambiguous;
+
+  return m_index[lo];
+}
+
+std::size_t
+validatestring_sorted_index::byte_size (void) const
+{
+  return (sizeof (*this) + m_folded.byte_size () - sizeof (m_folded)
+          + m_index.capacity () * sizeof (std::size_t)
+          + m_keys.capacity () * sizeof (std::uint64_t)
+          + m_ranks.capacity () * sizeof (std::size_t));
+}
+
+std::size_t
+validatestring_sorted_index::estimated_byte_size (std::size_t n,
+                                                  std::size_t len)
+{
+  std::size_t nwords = (n + 1
+                        + (len + sizeof (std::size_t) - 1)
+                          / sizeof (std::size_t));
+
+  return (sizeof (validatestring_sorted_index)
+          + nwords * sizeof (std::size_t) + n * sizeof (std::size_t)
+          + (n + 1) * (sizeof (std::uint64_t) + sizeof (std::size_t)));
+}
+
+// Nodes are created breadth first from ranges of the sorted, distinct,
+// folded strings that share their first DEPTH bytes.  The base of a node is
+// the first one for which all its child slots are free, searched from the
+// first free slot as in Darts.  Answers are filled in afterwards, children
+// before parents.
+
+validatestring_dat_index::validatestring_dat_index
+  (const validatestring_strings& strs)
+  : m_size (strs.size ()), m_base (), m_check (), m_answer (), m_tails (),
+    m_tail_offsets ()
+{
+  struct range
+  {
+    std::int32_t state;
+    std::size_t  lo;
+    std::size_t  hi;
+    std::size_t  depth;
+  };
+
+  validatestring_arena folded (strs, true);
+  std::vector<std::size_t> order = validatestring_distinct_order (folded);
+
+  // Strings that end at a node, and the only child of nodes with one.
+  std::vector<std::int32_t> terminal;
+  std::vector<std::int32_t> only_child;
+  std::vector<std::int32_t> created;
+
+  auto grow = [&] (std::size_t n)
+    {
+      if (m_check.size () < n)
+        {
+          m_base.resize (n, 0);
+          m_check.resize (n, -1);
+          m_answer.resize (n, validatestring_no_match);
+          terminal.resize (n, -1);
+          only_child.resize (n, -1);
+        }
+    };
+
+  grow (1);
+  m_check[0] = 0;
+  created.push_back (0);
+
+  std::vector<range> queue;
+  if (! order.empty ())
+    queue.push_back (range {0, 0, order.size (), 0});
+
+  std::vector<std::size_t> codes;
+  std::vector<std::size_t> starts;
+  std::size_t next_check_pos = 1;
+
+  for (std::size_t q = 0; q < queue.size (); q++)
+    {
+      range r = queue[q];
+      std::string_view first = folded(order[r.lo]);
+
+      if (r.hi - r.lo == 1)
+        {
+          m_base[r.state] = -1 - static_cast<std::int32_t>
+                                   (m_tail_offsets.size ());
+          m_answer[r.state] = order[r.lo];
+          m_tail_offsets.push_back (m_tails.length ());
+          m_tails.append (first, r.depth, std::string::npos);
+          continue;
+        }
+
+      std::size_t lo = r.lo;
+      if (first.length () == r.depth)
+        terminal[r.state] = order[lo++];
+
+      codes.clear ();
+      starts.clear ();
+      for (std::size_t i = lo; i < r.hi; i++)
+        {
+          std::size_t c = static_cast<unsigned char>
+                            (folded(order[i])[r.depth]) + 1;
+          if (codes.empty () || codes.back () != c)
+            {
+              codes.push_back (c);
+              starts.push_back (i);
+            }
+        }
+      starts.push_back (r.hi);
+
+      std::size_t pos = std::max (codes.front () + 1, next_check_pos) - 1;
+      std::size_t nused = 0;
+      bool first_free = true;
+      std::size_t b;
+
+      while (true)
+        {
+          pos++;
+          grow (pos + 1);
+          if (m_check[pos] >= 0)
+            {
+              nused++;
+              continue;
+            }
+          if (first_free)
+            {
+              next_check_pos = pos;
+              first_free = false;
+            }
+
+          b = pos - codes.front ();
+          grow (b + codes.back () + 1);
+
+          bool fits = true;
+          for (std::size_t c : codes)
+            {
+              if (m_check[b + c] >= 0)
+                {
+                  fits = false;
+                  break;
+                }
+            }
+          if (fits)
+            break;
+        }
+
+      // Skip over densely used regions in later searches.
+      if (nused * 20 >= (pos - next_check_pos + 1) * 19)
+        next_check_pos = pos;
+
+      m_base[r.state] = b;
+      for (std::size_t k = 0; k < codes.size (); k++)
+        {
+          std::int32_t t = b + codes[k];
+          m_check[t] = r.state;
+          created.push_back (t);
+          queue.push_back (range {t, starts[k], starts[k+1], r.depth + 1});
+        }
+      if (codes.size () == 1)
+        only_child[r.state] = b + codes.front ();
+    }
+
+  for (std::size_t k = created.size (); k-- > 0; )
+    {
+      std::int32_t s = created[k];
+      if (m_base[s] < 0)
+        continue;
+      if (terminal[s] >= 0)
+        m_answer[s] = terminal[s];
+      else if (only_child[s] >= 0)
+        m_answer[s] = m_answer[only_child[s]];
+      else
+        m_answer[s] = validatestring_ambiguous;
+    }
+
+  m_tail_offsets.push_back (m_tails.length ());
+
+  std::size_t nslots = m_check.size ();
+  while (nslots > 1 && m_check[nslots-1] < 0)
+    nslots--;
+  m_base.resize (nslots);
+  m_check.resize (nslots);
+  m_answer.resize (nslots);
+  m_base.shrink_to_fit ();
+  m_check.shrink_to_fit ();
+  m_answer.shrink_to_fit ();
+  m_tails.shrink_to_fit ();
+  m_tail_offsets.shrink_to_fit ();
+}
+
+validatestring_match
+validatestring_dat_index::lookup (std::string_view str) const
+{
+  std::int32_t s = 0;
+
+  for (std::size_t j = 0; j < str.length (); j++)
+    {
+      std::int32_t b = m_base[s];
+
+      if (b < 0)
+        {
+          std::size_t tail = -1 - b;
+          std::size_t start = m_tail_offsets[tail];
+          std::size_t len = m_tail_offsets[tail+1] - start;
+          std::size_t rest = str.length () - j;
+          if (rest > len)
+            return validatestring_no_match;
+          for (std::size_t k = 0; k < rest; k++)
+            {
+              if (validatestring_fold (str[j+k])
+                  != static_cast<unsigned char> (m_tails[start+k]))
+                return validatestring_no_match;
+            }
+          return m_answer[s];
+        }
+
+      std::size_t t = b + validatestring_fold (str[j]) + 1;
+      if (t >= m_check.size () || m_check[t] != s)
+        return validatestring_no_match;
+      s = t;
+    }
+
+  return m_answer[s];
+}
+
+std::size_t
+validatestring_dat_index::byte_size (void) const
+{
+  return (sizeof (*this)
+          + (m_base.capacity () + m_check.capacity () + m_answer.capacity ())
+            * sizeof (std::int32_t)
+          + m_tails.capacity ()
+          + m_tail_offsets.capacity () * sizeof (std::uint32_t));
+}
+
+// Lengths in the front-coded blocks are stored 7 bits per byte, low bits
+// first, with the high bit set on all bytes but the last.
+
+static void
+validatestring_put_length (std::string& data, std::size_t len)
+{
+  while (len >= 0x80)
+    {
+      data += static_cast<char> (0x80 | (len & 0x7f));
+      len >>= 7;
+    }
+  data += static_cast<char> (len);
+}
+
+static std::size_t
+validatestring_get_length (const char *& p)
+{
+  std::size_t len = 0;
+  for (int shift = 0; ; shift += 7)
+    {
+      unsigned char c = *p++;
+      len |= static_cast<std::size_t> (c & 0x7f) << shift;
+      if (c < 0x80)
+        return len;
+    }
+}
+
+validatestring_front_coded_index::validatestring_front_coded_index
+  (const validatestring_strings& strs)
+  : m_size (strs.size ()), m_data (), m_blocks (), m_index ()
+{
+  validatestring_arena folded (strs, true);
+  std::vector<std::size_t> order = validatestring_distinct_order (folded);
+
+  m_index.assign (order.begin (), order.end ());
+  m_blocks.reserve ((order.size () + block_size - 1) / block_size);
+
+  for (std::size_t pos = 0; pos < order.size (); pos++)
+    {
+      std::string_view s = folded(order[pos]);
+
+      if (pos % block_size == 0)
+        {
+          m_blocks.push_back (m_data.length ());
+          validatestring_put_length (m_data, s.length ());
+          m_data += s;
+        }
+      else
+        {
+          std::string_view prev = folded(order[pos-1]);
+          std::size_t lcp = 0;
+          while (lcp < s.length () && lcp < prev.length ()
+                 && s[lcp] == prev[lcp])
+            lcp++;
+          validatestring_put_length (m_data, lcp);
+          validatestring_put_length (m_data, s.length () - lcp);
+          m_data.append (s, lcp, std::string::npos);
+        }
+    }
+
+  m_data.shrink_to_fit ();
+}
+
+std::string_view
+validatestring_front_coded_index::head (std::size_t block) const
+{
+  const char *p = m_data.data () + m_blocks[block];
+  std::size_t len = validatestring_get_length (p);
+  return std::string_view (p, len);
+}
+
+// First sorted position whose string is not BEFORE, where BEFORE is true
+// for the strings before the position sought.  The string at that position
+// is decoded into S.
+
+template <typename Before>
+std::size_t
+validatestring_front_coded_index::search (Before before, std::string& s) const
+{
+  std::size_t nblocks = m_blocks.size ();
+  std::size_t lo = 0;
+  std::size_t hi = nblocks;
+
+  while (lo < hi)
+    {
+      std::size_t mid = lo + (hi - lo) / 2;
+      if (before (head (mid)))
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+  // The position is after the first string of block LO - 1, or is the
+  // first string of block LO.
+  if (lo > 0)
+    {
+      std::size_t pos = (lo - 1) * block_size;
+      std::size_t end = std::min (pos + block_size, m_index.size ());
+      const char *p = m_data.data () + m_blocks[lo-1];
+      std::size_t len = validatestring_get_length (p);
+      s.assign (p, len);
+      p += len;
+
+      while (++pos < end)
+        {
+          std::size_t lcp = validatestring_get_length (p);
+          len = validatestring_get_length (p);
+          s.resize (lcp);
+          s.append (p, len);
+          p += len;
+          if (! before (s))
+            return pos;
+        }
+    }
+
+  if (lo == nblocks)
+    return m_index.size ();
+
+  s = head (lo);
+  return lo * block_size;
+}
+
+validatestring_match
+validatestring_front_coded_index::lookup (std::string_view str) const
+{
+  std::string q = validatestring_folded (str);
+  std::size_t q_len = q.length ();
+  std::size_t n = m_index.size ();
+  std::string s;
+
+  std::size_t lo = search ([&q] (std::string_view t) { return t < q; }, s);
+
+  if (lo == n || s.compare (0, q_len, q) != 0)
+    return validatestring_no_match;
+
+  // Past the strings that have the first match as a prefix.
+  std::string m = s;
+  std::size_t hi = search ([&m] (std::string_view t)
+    { return t.substr (0, m.length ()) <= m; }, s);
+
+  if (hi < n && s.compare (0, q_len, m, 0, q_len) == 0)
+    return validatestring_ambiguous;
+
+  return m_index[lo];
+}
+
+std::size_t
+validatestring_front_coded_index::byte_size (void) const
+{
+  return (sizeof (*this) + m_data.capacity ()
+          + m_blocks.capacity () * sizeof (std::size_t)
+          + m_index.capacity () * sizeof (std::uint32_t));
+}
+
+// State of a scan over part of the strings: the first match, the length of
+// the common prefix of all matches, and the first of the shortest matches.
+
+struct validatestring_scan_state
+{
+  std::string_view     first;
+  std::size_t          common_len  = 0;
+  std::size_t          min_len     = 0;
+  validatestring_match min_len_idx = validatestring_no_match;
+};
+
+// Add to ST the string S at index I, which a string of length STR_LEN is a
+// prefix of.
+
+static void
+validatestring_scan_add (std::size_t str_len, std::string_view s,
+                         std::size_t i, validatestring_scan_state& st)
+{
+  if (st.min_len_idx < 0)
+    {
+      st.first       = s;
+      st.common_len  = s.length ();
+      st.min_len     = s.length ();
+      st.min_len_idx = i;
+      return;
+    }
+
+  std::size_t j = str_len;
+  while (j < st.common_len && j < s.length ()
+         && validatestring_fold (s[j]) == validatestring_fold (st.first[j]))
+    j++;
+  st.common_len = j;
+
+  if (s.length () < st.min_len)
+    {
+      st.min_len     = s.length ();
+      st.min_len_idx = i;
+    }
+}
+
+static void
+validatestring_scan_range (std::string_view str, const std::string& folded,
+                           const validatestring_strings& strs,
+                           std::size_t begin, std::size_t end,
+                           validatestring_scan_state& st)
+{
+  for (std::size_t i = begin; i < end; i++)
+    {
+      std::string_view s = strs(i);
+
+      if (s.length () >= str.length ()
+          && validatestring_prefix_folded (folded.data (), s.data (),
+                                           str.length ()))
+        validatestring_scan_add (str.length (), s, i, st);
+    }
+}
+
+// The result of a scan that has reached state ST.
+
+static validatestring_match
+validatestring_scan_result (const validatestring_scan_state& st)
+{
+  if (st.min_len_idx >= 0 && st.common_len < st.min_len)
+    return validatestring_ambiguous;
+
+  return st.min_len_idx;
+}
+
+// Merge into A the state B of the strings that follow those of A.  Ties
+// between shortest matches are won by A, as in a single scan.
+
+static void
+validatestring_scan_merge (std::size_t str_len, validatestring_scan_state& a,
+                           const validatestring_scan_state& b)
+{
+  if (b.min_len_idx < 0)
+    return;
+
+  if (a.min_len_idx < 0)
+    {
+      a = b;
+      return;
+    }
+
+  std::size_t j = str_len;
+  std::size_t n = std::min (a.common_len, b.common_len);
+  while (j < n && (validatestring_fold (a.first[j])
+                   == validatestring_fold (b.first[j])))
+    j++;
+  a.common_len = j;
+
+  if (b.min_len < a.min_len)
+    {
+      a.min_len     = b.min_len;
+      a.min_len_idx = b.min_len_idx;
+    }
+}
+
+std::size_t
+validatestring_nthreads (std::size_t n, std::size_t min_items,
+                         std::size_t nthreads)
+{
+  // hardware_concurrency may read the system configuration on every call.
+  static const std::size_t ncores
+    = std::max (1u, std::thread::hardware_concurrency ());
+
+  if (nthreads == 0)
+    nthreads = ncores;
+
+  return std::max<std::size_t> (1, std::min (nthreads, n / min_items));
+}
+
+// The result is the first of the shortest matches if it is a prefix of all
+// the others, which is the case exactly when the common prefix of all
+// matches is as long as it.  Threads scan contiguous parts of the strings,
+// and their states are merged in order, so the result does not depend on
+// the number of threads.
+
+validatestring_match
+validatestring_scan (std::string_view str, const validatestring_strings& strs,
+                     std::size_t nthreads)
+{
+  std::size_t nstrs  = strs.size ();
+  std::string folded = validatestring_folded (str);
+
+  std::size_t nparts = validatestring_nthreads (nstrs,
+                                                validatestring_min_thread_strs,
+                                                nthreads);
+
+  std::vector<validatestring_scan_state> parts (nparts);
+
+  if (nparts == 1)
+    validatestring_scan_range (str, folded, strs, 0, nstrs, parts[0]);
+  else
+    {
+      std::vector<std::future<void>> workers;
+
+      for (std::size_t k = 1; k < nparts; k++)
+        workers.push_back (std::async (std::launch::async, [&, k] (void)
+          {
+            validatestring_scan_range (str, folded, strs, k * nstrs / nparts,
+                                       (k + 1) * nstrs / nparts, parts[k]);
+          }));
+
+      validatestring_scan_range (str, folded, strs, 0, nstrs / nparts,
+                                 parts[0]);
+
+      for (std::size_t k = 1; k < nparts; k++)
+        {
+          workers[k-1].get ();
+          validatestring_scan_merge (str.length (), parts[0], parts[k]);
+        }
+    }
+
+  return validatestring_scan_result (parts[0]);
+}
+
+// Number of trailing zero bits of X, which is not 0.
+
+static std::size_t
+validatestring_ctz (std::uint64_t x)
+{
+#if defined (__GNUC__)
+  return __builtin_ctzll (x);
+#else
+  std::size_t n = 0;
+  for (; ! (x & 1); x >>= 1)
+    n++;
+  return n;
+#endif
+}
+
+validatestring_bitslice_index::validatestring_bitslice_index
+  (const validatestring_strings& strs)
+  : m_nwords ((strs.size () + 63) / 64), m_slices (max_depth * 256, -1),
+    m_bits (), m_folded (strs, true), m_exact (m_folded)
+{
+  std::size_t n = strs.size ();
+
+  for (std::size_t i = 0; i < n; i++)
+    {
+      std::string_view s = m_folded(i);
+      for (std::size_t p = 0; p < std::min (s.length (), max_depth); p++)
+        {
+          std::ptrdiff_t& slice
+            = m_slices[p * 256 + static_cast<unsigned char> (s[p])];
+          if (slice < 0)
+            {
+              slice = m_bits.size ();
+              m_bits.resize (m_bits.size () + m_nwords, 0);
+            }
+          m_bits[slice + i / 64] |= std::uint64_t (1) << (i % 64);
+        }
+    }
+
+  m_bits.shrink_to_fit ();
+}
+
+validatestring_match
+validatestring_bitslice_index::lookup (std::string_view str) const
+{
+  validatestring_match exact = m_exact.find (str, m_folded);
+  if (exact >= 0)
+    return exact;
+
+  std::size_t n = size ();
+  std::size_t depth = std::min (str.length (), max_depth);
+  const std::uint64_t *slices[max_depth];
+
+  for (std::size_t p = 0; p < depth; p++)
+    {
+      std::ptrdiff_t slice = m_slices[p * 256 + validatestring_fold (str[p])];
+      if (slice < 0)
+        return validatestring_no_match;
+      slices[p] = m_bits.data () + slice;
+    }
+
+  validatestring_scan_state st;
+
+  for (std::size_t w = 0; w < m_nwords; w++)
+    {
+      std::uint64_t word = ~std::uint64_t (0);
+      if (w == m_nwords - 1 && n % 64)
+        word >>= 64 - n % 64;
+      for (std::size_t p = 0; p < depth && word; p++)
+        word &= slices[p][w];
+
+      while (word)
+        {
+          std::size_t i = 64 * w + validatestring_ctz (word);
+          word &= word - 1;
+
+          std::string_view s = m_folded(i);
+          if (depth < str.length () && ! validatestring_prefix (str, s))
+            continue;
+          validatestring_scan_add (str.length (), s, i, st);
+        }
+    }
+
+  return validatestring_scan_result (st);
+}
+
+std::size_t
+validatestring_bitslice_index::byte_size (void) const
+{
+  return (sizeof (*this) + m_slices.capacity () * sizeof (std::ptrdiff_t)
+          + m_bits.capacity () * sizeof (std::uint64_t)
+          + m_folded.byte_size () - sizeof (m_folded) + m_exact.byte_size ());
+}
+
+validatestring_packed_index::validatestring_packed_index
+  (const validatestring_strings& strs)
+  : m_keys (strs.size ()), m_folded (strs, true), m_exact (m_folded)
+{
+  for (std::size_t i = 0; i < m_keys.size (); i++)
+    m_keys[i] = validatestring_key (m_folded(i));
+}
+
+// A string can only match if its key agrees with that of the query on the
+// bytes of the query, and is as long as the query.  Keys are checked 64 at
+// a time, and the strings that pass are added to the scan state in order.
+
+validatestring_match
+validatestring_packed_index::lookup (std::string_view str) const
+{
+  validatestring_match exact = m_exact.find (str, m_folded);
+  if (exact >= 0)
+    return exact;
+
+  std::size_t n = m_keys.size ();
+  std::size_t len = str.length ();
+  std::size_t key_len = std::min<std::size_t> (len, 8);
+
+  char head[8];
+  for (std::size_t j = 0; j < key_len; j++)
+    head[j] = validatestring_fold (str[j]);
+
+  std::uint64_t mask = (key_len == 8 ? ~std::uint64_t (0)
+                        : ~(~std::uint64_t (0) >> (8 * key_len)));
+  std::uint64_t key = validatestring_key (std::string_view (head, key_len));
+
+  validatestring_scan_state st;
+
+  for (std::size_t b = 0; b < n; b += 64)
+    {
+      std::uint64_t bits = validatestring_filter (m_keys.data () + b,
+                                                  std::min<std::size_t>
+                                                    (64, n - b),
+                                                  key, mask);
+      while (bits)
+        {
+          std::size_t i = b + validatestring_ctz (bits);
+          bits &= bits - 1;
+
+          std::string_view s = m_folded(i);
+          if (s.length () < len
+              || (len > 8 && ! validatestring_prefix (str.substr (8),
+                                                      s.substr (8))))
+            continue;
+          validatestring_scan_add (len, s, i, st);
+        }
+    }
+
+  return validatestring_scan_result (st);
+}
+
+std::size_t
+validatestring_packed_index::byte_size (void) const
+{
+  return (sizeof (*this) + m_keys.capacity () * sizeof (std::uint64_t)
+          + m_folded.byte_size () - sizeof (m_folded) + m_exact.byte_size ());
+}
+
+// Chunks of queries initially assigned to a thread, from NEXT to END.  Any
+// thread may claim the next one, so the owner and thieves all take them in
+// order, and each chunk is claimed exactly once.
+
+struct alignas (64) validatestring_chunk_share
+{
+  std::atomic<std::size_t> next;
+  std::size_t              end;
+};
+
+void
+validatestring_lookup_all (const validatestring_index& index,
+                           const validatestring_strings& queries,
+                           validatestring_match *results,
+                           std::size_t nthreads, void (*check) (void))
+{
+  std::size_t n = queries.size ();
+
+  std::size_t nworkers
+    = validatestring_nthreads (n, validatestring_min_thread_queries,
+                               nthreads);
+
+  if (nworkers == 1)
+    {
+      for (std::size_t i = 0; i < n; i++)
+        {
+          results[i] = index.lookup (queries(i));
+          if (check && (i + 1) % validatestring_chunk_size == 0)
+            check ();
+        }
+      return;
+    }
+
+  std::size_t nchunks = (n + validatestring_chunk_size - 1)
+                        / validatestring_chunk_size;
+
+  std::vector<validatestring_chunk_share> shares (nworkers);
+  for (std::size_t w = 0; w < nworkers; w++)
+    {
+      shares[w].next = w * nchunks / nworkers;
+      shares[w].end  = (w + 1) * nchunks / nworkers;
+    }
+
+  // Set once CHECK has thrown, which is only called by thread 0.
+  std::atomic<bool> stop (false);
+  std::exception_ptr interrupt;
+
+  auto work = [&] (std::size_t w)
+    {
+      for (std::size_t k = 0; k < nworkers; k++)
+        {
+          validatestring_chunk_share& share = shares[(w + k) % nworkers];
+          std::size_t c;
+          while (! stop.load (std::memory_order_relaxed)
+                 && (c = share.next.fetch_add (1)) < share.end)
+            {
+              std::size_t begin = c * validatestring_chunk_size;
+              std::size_t end = std::min (n, begin + validatestring_chunk_size);
+              for (std::size_t i = begin; i < end; i++)
+                results[i] = index.lookup (queries(i));
+
+              if (w == 0 && check)
+                {
+                  try
+                    {
+                      check ();
+                    }
+                  catch (...)
+                    {
+                      interrupt = std::current_exception ();
+                      stop.store (true, std::memory_order_relaxed);
+                    }
+                }
+            }
+        }
+    };
+
+  std::vector<std::future<void>> workers;
+  for (std::size_t w = 1; w < nworkers; w++)
+    workers.push_back (std::async (std::launch::async, work, w));
+
+  work (0);
+
+  for (auto& w : workers)
+    w.get ();
+
+  if (interrupt)
+    std::rethrow_exception (interrupt);
+}
+
+// The list is measured before it is built so that MSG grows only once.
+
+void
+validatestring_append_list (std::string& msg, std::string_view str,
+                            const validatestring_strings& strs,
+                            bool matches_only, std::size_t limit)
+{
+  std::size_t nstrs   = strs.size ();
+  std::size_t nlisted = 0;
+  std::size_t nmore   = 0;
+  std::size_t end     = 0;
+  std::size_t len     = 0;
+  bool        first   = true;
+  std::string more;
+
+  if (limit == 0)
+    limit = nstrs;
+
+  for (std::size_t i = 0; i < nstrs; i++)
+    {
+      if (! matches_only && nlisted == limit)
+        {
+          nmore = nstrs - i;
+          break;
+        }
+
+      std::string_view s = strs(i);
+      if (matches_only && ! validatestring_prefix (str, s))
+        continue;
+
+      if (nlisted < limit)
+        {
+          len += (nlisted > 0 ? 2 : 0) + s.length ();
+          nlisted++;
+          end = i + 1;
+        }
+      else
+        nmore++;
+    }
+
+  if (nmore > 0)
+    more = ", ... and " + std::to_string (nmore) + " more";
+
+  msg.reserve (msg.length () + len + more.length ());
+
+  for (std::size_t i = 0; i < end; i++)
+    {
+      std::string_view s = strs(i);
+      if (matches_only && ! validatestring_prefix (str, s))
+        continue;
+
+      if (! first)
+        msg += ", ";
+      msg += s;
+      first = false;
+    }
+
+  msg += more;
+}
+
+std::string
+validatestring_errstr (std::string_view funcname, std::string_view varname,
+                       std::string_view name, std::size_t position)
+{
+  std::string errstr;
+
+  if (! funcname.empty ())
+    {
+      errstr += funcname;
+      errstr += ": ";
+    }
+
+  errstr += (varname.empty () ? name : varname);
+  errstr += ' ';
+
+  if (position > 0)
+    errstr += "(argument #" + std::to_string (position) + ") ";
+
+  return errstr;
+}
+
+std::string
+validatestring_message (validatestring_match result, std::string_view errstr,
+                        std::string_view str,
+                        const validatestring_strings& strs, std::size_t limit)
+{
+  std::string msg = "validatestring: ";
+  msg += errstr;
+
+  if (result == validatestring_no_match)
+    {
+      msg += "does not match any of \n";
+      validatestring_append_list (msg, str, strs, false, limit);
+    }
+  else
+    {
+      msg += "allows multiple unique matches:\n";
+      validatestring_append_list (msg, str, strs, true, limit);
+    }
+
+  return msg;
+}
+
+validatestring_match
+validatestring_validate (std::string_view str,
+                         const validatestring_strings& strs,
+                         const validatestring_index *index,
+                         std::string *errmsg,
+                         const validatestring_context& context,
+                         std::size_t nthreads)
+{
+  validatestring_match result
+    = (index ? index->lookup (str)
+             : validatestring_scan (str, strs, nthreads));
+
+  if (result < 0 && errmsg)
+    {
+      std::string errstr
+        = validatestring_errstr (context.funcname, context.varname,
+                                 "'" + std::string (str) + "'",
+                                 context.position);
+
+      *errmsg = validatestring_message (result, errstr, str, strs,
+                                        context.limit);
+    }
+
+  return result;
+}
+
+std::size_t
+validatestring_hash (const validatestring_strings& strs)
+{
+  // FNV-1a over the strings and their lengths.
+  std::size_t h = 14695981039346656037ULL;
+  std::size_t nstrs = strs.size ();
+  for (std::size_t i = 0; i < nstrs; i++)
+    {
+      std::string_view s = strs(i);
+      for (std::size_t j = 0; j < s.length (); j++)
+        h = (h ^ static_cast<unsigned char> (s[j])) * 1099511628211ULL;
+      h = (h ^ s.length ()) * 1099511628211ULL;
+    }
+  return h;
+}
+
+bool
+validatestring_equal (const validatestring_strings& a,
+                      const validatestring_strings& b)
+{
+  std::size_t n = a.size ();
+  if (b.size () != n)
+    return false;
+  for (std::size_t i = 0; i < n; i++)
+    {
+      if (a(i) != b(i))
+        return false;
+    }
+  return true;
+}
@@ -0,0 +1,573 @@
+/*
+
+Copyright (C) 2018-2018 Gene Harvey
+
+This file is part of Octave.
+
+Octave is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Octave is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Octave; see the file COPYING.  If not, see
+<https://www.gnu.org/licenses/>.
+
+*/
+
+#if ! defined (octave_validatestring_engine_h)
+#define octave_validatestring_engine_h 1
+
+// Matching engine of validatestring.  It does not depend on the
+// interpreter: the strings to search are read through validatestring_strings
+// and the results are indices into them.
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "validatestring-kernel.h"
+
+// Result of a lookup: the index of the validated string, or one of the
+// negative values below.
+
+typedef std::ptrdiff_t validatestring_match;
+
+const validatestring_match validatestring_no_match  = -1;
+const validatestring_match validatestring_ambiguous = -2;
+
+// 1 for a match, 0 if nothing matches, and -1 if the match is ambiguous.
+
+inline int
+validatestring_status (validatestring_match m)
+{
+  if (m >= 0)
+    return 1;
+  return (m == validatestring_no_match ? 0 : -1);
+}
+
+// True if STR is a case-insensitive prefix of S.
+
+constexpr bool
+validatestring_prefix (std::string_view str, std::string_view s)
+{
+  if (s.length () < str.length ())
+    return false;
+
+  for (std::size_t j = 0; j < str.length (); j++)
+    {
+      if (validatestring_fold (str[j]) != validatestring_fold (s[j]))
+        return false;
+    }
+
+  return true;
+}
+
+// Sequence of strings searched by the engine.  A view returned for an
+// element must remain valid for as long as the sequence exists.  Elements
+// may be read by several threads at once.
+
+class validatestring_strings
+{
+public:
+
+  virtual ~validatestring_strings (void) = default;
+
+  virtual std::size_t size (void) const = 0;
+
+  virtual std::string_view operator () (std::size_t i) const = 0;
+};
+
+// Strings owned by the caller.
+
+class validatestring_string_views : public validatestring_strings
+{
+public:
+
+  validatestring_string_views (const std::string_view *views, std::size_t n)
+    : m_views (views), m_n (n)
+  { }
+
+  validatestring_string_views (const std::vector<std::string_view>& views)
+    : m_views (views.data ()), m_n (views.size ())
+  { }
+
+  std::size_t size (void) const { return m_n; }
+
+  std::string_view operator () (std::size_t i) const { return m_views[i]; }
+
+private:
+
+  const std::string_view *m_views;
+
+  std::size_t m_n;
+};
+
+// Copy of a sequence of strings, case folded if FOLD is true, in a single
+// allocation: the offsets of the strings followed by their bytes, end to
+// end.  Reading the strings in order then reads consecutive memory, where
+// std::string or octave_value elements each live in their own heap block.
+// Every engine can read it as a validatestring_strings.
+
+class validatestring_arena : public validatestring_strings
+{
+public:
+
+  validatestring_arena (void) : m_size (0), m_nwords (0), m_data () { }
+
+  validatestring_arena (const validatestring_strings& strs, bool fold = false);
+
+  validatestring_arena (const validatestring_arena&) = delete;
+
+  validatestring_arena (validatestring_arena&&) = default;
+
+  validatestring_arena& operator = (const validatestring_arena&) = delete;
+
+  validatestring_arena& operator = (validatestring_arena&&) = default;
+
+  std::size_t size (void) const { return m_size; }
+
+  std::string_view operator () (std::size_t i) const
+  {
+    const std::size_t *offsets = m_data.get ();
+    return std::string_view (chars () + offsets[i],
+                             offsets[i+1] - offsets[i]);
+  }
+
+  std::size_t byte_size (void) const
+  { return sizeof (*this) + m_nwords * sizeof (std::size_t); }
+
+private:
+
+  const char * chars (void) const
+  { return reinterpret_cast<const char *> (m_data.get () + m_size + 1); }
+
+  std::size_t m_size;
+
+  std::size_t m_nwords;
+
+  std::unique_ptr<std::size_t[]> m_data;
+};
+
+// Indices of the strings of FOLDED in sorted order, with only the first of
+// equal strings, which is the only one that can be the result of a lookup.
+// For the indices that are built over sorted case-folded strings.
+
+extern std::vector<std::size_t>
+validatestring_distinct_order (const validatestring_strings& folded);
+
+// Hash table of case-folded strings, giving the first of them equal to a
+// query once folded.  That string is the result of a lookup whenever it
+// exists, since every other string the query is a prefix of is at least as
+// long and starts with it.  A hit is then found in time proportional to the
+// length of the query, which suits indices that otherwise scan.  The table
+// holds only indices, for at most 2^32 - 1 strings: the folded strings are
+// passed to every lookup.
+
+class validatestring_exact_table
+{
+public:
+
+  validatestring_exact_table (const validatestring_strings& folded);
+
+  validatestring_match find (std::string_view str,
+                             const validatestring_strings& folded) const;
+
+  std::size_t byte_size (void) const
+  { return m_slots.capacity () * sizeof (std::uint32_t); }
+
+private:
+
+  static std::size_t hash (std::string_view str);
+
+  // Index plus 1 of the string in each slot, or 0 if it is empty.  The
+  // slots are probed linearly.
+  std::vector<std::uint32_t> m_slots;
+};
+
+// Precomputed index over a sequence of strings, answering lookups with the
+// same results as a linear scan of them.
+
+class validatestring_index
+{
+public:
+
+  virtual ~validatestring_index (void) = default;
+
+  // Number of strings indexed.
+  virtual std::size_t size (void) const = 0;
+
+  virtual validatestring_match lookup (std::string_view str) const = 0;
+
+  // Memory used by the index, in bytes.
+  virtual std::size_t byte_size (void) const = 0;
+};
+
+// Trie over the case-folded strings.  Every node stores the answer for a
+// query equal to the prefix it represents, so a lookup is a single walk
+// down the trie.  The strings themselves are not kept.
+
+class validatestring_trie : public validatestring_index
+{
+public:
+
+  validatestring_trie (const validatestring_strings& strs);
+
+  std::size_t size (void) const { return m_size; }
+
+  validatestring_match lookup (std::string_view str) const;
+
+  std::size_t byte_size (void) const
+  { return sizeof (*this) + m_nodes.capacity () * sizeof (node); }
+
+private:
+
+  struct node
+  {
+    node (unsigned char k)
+      : key (k), first_child (-1), next_sibling (-1), first_elem (-1),
+        answer (validatestring_no_match)
+    { }
+
+    unsigned char  key;
+    std::ptrdiff_t first_child;
+    std::ptrdiff_t next_sibling;
+    std::ptrdiff_t first_elem;
+    std::ptrdiff_t answer;
+  };
+
+  std::ptrdiff_t find_child (std::ptrdiff_t n, unsigned char key) const;
+
+  std::size_t m_size;
+
+  std::vector<node> m_nodes;
+};
+
+// Case-folded copy of the strings, sorted with their original indices.  The
+// strings that a query is a prefix of form one range, found by binary
+// search.  The first of them is the only possible result, and the match is
+// ambiguous if a string after those it is a prefix of is still in the
+// range.  The first 8 bytes of every string are also kept in an array in
+// Eytzinger order, the breadth-first order of the binary search tree, so
+// that the first steps of every search stay in cache.
+
+class validatestring_sorted_index : public validatestring_index
+{
+public:
+
+  validatestring_sorted_index (const validatestring_strings& strs);
+
+  std::size_t size (void) const { return m_index.size (); }
+
+  validatestring_match lookup (std::string_view str) const;
+
+  std::size_t byte_size (void) const;
+
+  // The byte_size of an index over N strings of LEN bytes in all, known
+  // before it is built.
+  static std::size_t estimated_byte_size (std::size_t n, std::size_t len);
+
+private:
+
+  std::string_view folded (std::size_t pos) const { return m_folded (pos); }
+
+  template <typename Less>
+  std::size_t search (Less less) const;
+
+  // Folded strings in sorted order.
+  validatestring_arena m_folded;
+
+  // Original index of each sorted string.
+  std::vector<std::size_t> m_index;
+
+  // Leading bytes of the strings, and their sorted positions, in Eytzinger
+  // order from element 1.
+  std::vector<std::uint64_t> m_keys;
+
+  std::vector<std::size_t> m_ranks;
+};
+
+// Double-array trie over the case-folded strings.  The children of node S
+// are at BASE[S] + C for every byte C + 1 that follows it, and CHECK holds
+// the parent of every slot, so that each step is two array reads.  Once a
+// single string remains below a node, the rest of it is kept in a separate
+// tail array rather than in nodes.  Like validatestring_trie, every node
+// holds the answer for a query ending there.  Each slot takes 12 bytes, for
+// at most 2^31 slots and strings.
+
+class validatestring_dat_index : public validatestring_index
+{
+public:
+
+  validatestring_dat_index (const validatestring_strings& strs);
+
+  std::size_t size (void) const { return m_size; }
+
+  validatestring_match lookup (std::string_view str) const;
+
+  std::size_t byte_size (void) const;
+
+private:
+
+  std::size_t m_size;
+
+  // Index of the first child slot, or -1 - N for the node ending in tail N.
+  std::vector<std::int32_t> m_base;
+
+  // Parent of each slot, or -1 if it is free.
+  std::vector<std::int32_t> m_check;
+
+  std::vector<std::int32_t> m_answer;
+
+  // Folded tails stored end to end, and the start of each one.
+  std::string m_tails;
+
+  std::vector<std::uint32_t> m_tail_offsets;
+};
+
+// Case-folded strings in sorted order, with repeated strings dropped, front
+// coded in blocks of block_size strings.  The first string of every block
+// is stored in full, and each of the others as the length of the prefix it
+// shares with the one before and the bytes that follow.  A search is a
+// binary search of the first strings of the blocks and a sequential
+// decoding of a single block.  Lookups then work as for
+// validatestring_sorted_index.  Strings that share long prefixes take little
+// more than their distinct suffixes.  At most 2^32 strings are supported.
+
+class validatestring_front_coded_index : public validatestring_index
+{
+public:
+
+  static constexpr std::size_t block_size = 16;
+
+  validatestring_front_coded_index (const validatestring_strings& strs);
+
+  std::size_t size (void) const { return m_size; }
+
+  validatestring_match lookup (std::string_view str) const;
+
+  std::size_t byte_size (void) const;
+
+private:
+
+  std::string_view head (std::size_t block) const;
+
+  template <typename Before>
+  std::size_t search (Before before, std::string& s) const;
+
+  std::size_t m_size;
+
+  // The encoded blocks, stored end to end, and the start of each one.
+  std::string m_data;
+
+  std::vector<std::size_t> m_blocks;
+
+  // Original index of each distinct sorted string.
+  std::vector<std::uint32_t> m_index;
+};
+
+// Bitsets of the strings that have each folded byte at each of their first
+// max_depth positions.  The strings that a query is a prefix of are those
+// in the AND of the bitsets of its first bytes, computed a word of 64
+// strings at a time, and checked for any bytes past max_depth.  The result
+// is then chosen among them as by a linear scan.  A lookup costs about one
+// word operation per 64 strings and byte of the query, which suits short
+// queries against lists of thousands of strings.  Queries equal to one of
+// the strings are answered first by a validatestring_exact_table.
+
+class validatestring_bitslice_index : public validatestring_index
+{
+public:
+
+  static constexpr std::size_t max_depth = 4;
+
+  validatestring_bitslice_index (const validatestring_strings& strs);
+
+  std::size_t size (void) const { return m_folded.size (); }
+
+  validatestring_match lookup (std::string_view str) const;
+
+  std::size_t byte_size (void) const;
+
+private:
+
+  // Words in each bitset.
+  std::size_t m_nwords;
+
+  // Start in m_bits of the bitset of each position and byte, or -1 if no
+  // string has that byte there.
+  std::vector<std::ptrdiff_t> m_slices;
+
+  std::vector<std::uint64_t> m_bits;
+
+  // Folded strings in their original order.
+  validatestring_arena m_folded;
+
+  validatestring_exact_table m_exact;
+};
+
+// Linear search over a packed copy of the strings.  The first 8 folded
+// bytes of every string are kept in one array, so that most strings are
+// rejected by a masked compare of their key, several at a time with
+// validatestring_filter, without reading the strings themselves.  Only the
+// strings that pass get the full comparison.  It uses little more memory
+// than the strings, and a lookup is a fast scan of 8 bytes per string.
+// Queries equal to one of the strings are answered first by a
+// validatestring_exact_table, without the scan.
+
+class validatestring_packed_index : public validatestring_index
+{
+public:
+
+  validatestring_packed_index (const validatestring_strings& strs);
+
+  std::size_t size (void) const { return m_keys.size (); }
+
+  validatestring_match lookup (std::string_view str) const;
+
+  std::size_t byte_size (void) const;
+
+private:
+
+  // First 8 folded bytes of each string, zero padded, in the order of
+  // validatestring_key.
+  std::vector<std::uint64_t> m_keys;
+
+  // Folded strings in their original order.
+  validatestring_arena m_folded;
+
+  validatestring_exact_table m_exact;
+};
+
+// Linear search for STR in STRS, with the same results as a trie.  Large
+// sequences are split among up to NTHREADS threads, or one per core if
+// NTHREADS is 0.  Each thread gets at least validatestring_min_thread_strs
+// strings, so smaller sequences are searched by the calling thread alone.
+
+const std::size_t validatestring_min_thread_strs = 65536;
+
+extern validatestring_match
+validatestring_scan (std::string_view str, const validatestring_strings& strs,
+                     std::size_t nthreads = 1);
+
+// Look up every element of QUERIES in INDEX, and store the results in
+// RESULTS, which must have room for all of them.  The queries are split into
+// chunks among up to NTHREADS threads, or one per core if NTHREADS is 0,
+// and a thread that has finished its own chunks takes chunks from the
+// others.  Each thread gets at least validatestring_min_thread_queries
+// queries.  No locks are taken, since every result is written by exactly
+// one thread and the index is only read.
+//
+// If CHECK is not null, the calling thread calls it after each chunk of
+// validatestring_chunk_size queries, so that it may throw to interrupt the
+// lookups.  The other threads then stop at the end of their current chunk,
+// and the exception is thrown again once they have all stopped.
+
+const std::size_t validatestring_min_thread_queries = 16384;
+
+// Number of queries claimed at a time by a thread.
+const std::size_t validatestring_chunk_size = 1024;
+
+extern void
+validatestring_lookup_all (const validatestring_index& index,
+                           const validatestring_strings& queries,
+                           validatestring_match *results,
+                           std::size_t nthreads = 1,
+                           void (*check) (void) = nullptr);
+
+// Number of threads to use for N items of work, given at least MIN_ITEMS
+// per thread and at most NTHREADS threads, or one per core if 0.
+
+extern std::size_t
+validatestring_nthreads (std::size_t n, std::size_t min_items,
+                         std::size_t nthreads);
+
+// Append to MSG the strings that STR is a prefix of, or all of them if
+// MATCHES_ONLY is false, separated by commas.  At most LIMIT of them are
+// listed, followed by a count of the others.  A LIMIT of 0 lists them all.
+
+extern void
+validatestring_append_list (std::string& msg, std::string_view str,
+                            const validatestring_strings& strs,
+                            bool matches_only, std::size_t limit);
+
+// Start of the error message for an invalid argument: "FUNCNAME: VARNAME
+// (argument #POSITION) ", where NAME is used if VARNAME is empty, and the
+// parts for an empty FUNCNAME or a POSITION of 0 are left out.
+
+extern std::string
+validatestring_errstr (std::string_view funcname, std::string_view varname,
+                       std::string_view name, std::size_t position);
+
+// Error message of validatestring for the lookup of STR in STRS that gave
+// RESULT, which is validatestring_no_match or validatestring_ambiguous.
+// ERRSTR is from validatestring_errstr, and LIMIT bounds the list of
+// strings as for validatestring_append_list.
+
+extern std::string
+validatestring_message (validatestring_match result, std::string_view errstr,
+                        std::string_view str,
+                        const validatestring_strings& strs,
+                        std::size_t limit);
+
+// Argument being validated, as named in error messages: FUNCNAME, VARNAME
+// and POSITION are as for validatestring_errstr, and LIMIT bounds the list
+// of strings as for validatestring_append_list.
+
+struct validatestring_context
+{
+  std::string_view funcname;
+  std::string_view varname;
+  std::size_t position = 0;
+  std::size_t limit = 0;
+};
+
+// Entry point for oct-files that validate their own arguments, with the
+// same results and error messages as validatestring and without calling
+// the interpreter.  STR is looked up in INDEX, which must have been built
+// from STRS, or else searched for in STRS with up to NTHREADS threads.  If
+// there is no unique match and ERRMSG is not null, the message that
+// validatestring raises for CONTEXT is stored in *ERRMSG.  Nothing is
+// formatted for a match.  For example:
+//
+//   static const std::string_view names[] = {"linear", "nearest", "cubic"};
+//   static const validatestring_string_views methods (names, 3);
+//   static const validatestring_trie index (methods);
+//
+//   std::string msg;
+//   validatestring_context context;
+//   context.funcname = "interp1";
+//   context.varname = "METHOD";
+//   context.position = 4;
+//   validatestring_match m
+//     = validatestring_validate (method, methods, &index, &msg, context);
+//   if (m < 0)
+//     error ("%s", msg.c_str ());
+
+extern validatestring_match
+validatestring_validate (std::string_view str,
+                         const validatestring_strings& strs,
+                         const validatestring_index *index = nullptr,
+                         std::string *errmsg = nullptr,
+                         const validatestring_context& context
+                           = validatestring_context (),
+                         std::size_t nthreads = 1);
+
+// Hash of the contents of STRS, and whether two sequences are equal.
+
+extern std::size_t
+validatestring_hash (const validatestring_strings& strs);
+
+extern bool
+validatestring_equal (const validatestring_strings& a,
+                      const validatestring_strings& b);
+
+#endif
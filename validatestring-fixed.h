@@ -0,0 +1,221 @@
+/*
+
+Copyright (C) 2018-2018 Gene Harvey
+
+This file is part of Octave.
+
+Octave is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Octave is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Octave; see the file COPYING.  If not, see
+<https://www.gnu.org/licenses/>.
+
+*/
+
+#if ! defined (octave_validatestring_fixed_h)
+#define octave_validatestring_fixed_h 1
+
+// validatestring for a list of strings fixed at compile time, such as the
+// options of a builtin function:
+//
+//   static constexpr validatestring_fixed methods ("linear", "nearest",
+//                                                  "cubic");
+//
+//   validatestring_match m = methods.lookup (str);
+//   if (m < 0)
+//     error ("%s", methods.message (m, validatestring_errstr ("interp1",
+//                                                          "METHOD", "", 0),
+//                                   str).c_str ());
+//
+// The compiler computes the result of every query that is a prefix of one
+// of the strings, and a hash table of the strings.  A lookup is then a
+// probe of the hash table for a query equal to one of the strings, and
+// otherwise a search for one string that the query is a prefix of, whose
+// table holds the result.  Lookups take no setup and allocate nothing, and
+// give the same results and error messages as validatestring.
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "validatestring-engine.h"
+
+// N strings of LEN characters in all.
+
+template <std::size_t N, std::size_t Len>
+class validatestring_fixed
+{
+public:
+
+  static_assert (N > 0, "validatestring_fixed: no strings");
+
+  template <std::size_t... Ls>
+  constexpr validatestring_fixed (const char (&... strs)[Ls])
+  {
+    static_assert (sizeof... (Ls) == N, "validatestring_fixed: wrong N");
+
+    const char *ptrs[] = { strs... };
+    std::size_t lens[] = { (Ls - 1)... };
+
+    std::size_t pos = 0;
+    for (std::size_t i = 0; i < N; i++)
+      {
+        m_offsets[i] = pos;
+        for (std::size_t j = 0; j < lens[i]; j++)
+          {
+            m_chars[pos] = ptrs[i][j];
+            m_folded[pos] = validatestring_fold (ptrs[i][j]);
+            pos++;
+          }
+      }
+    m_offsets[N] = pos;
+
+    m_empty_answer = answer (0, 0);
+    for (std::size_t i = 0; i < N; i++)
+      for (std::size_t len = 1; len <= folded (i).length (); len++)
+        m_answers[m_offsets[i] + len - 1] = answer (i, len);
+
+    // Of equal strings, only the first is entered.
+    for (std::size_t k = 0; k < nslots; k++)
+      m_slots[k] = validatestring_no_match;
+    for (std::size_t i = 0; i < N; i++)
+      {
+        std::size_t k = hash (folded (i));
+        while (m_slots[k] >= 0 && folded (m_slots[k]) != folded (i))
+          k = (k + 1) & (nslots - 1);
+        if (m_slots[k] < 0)
+          m_slots[k] = i;
+      }
+  }
+
+  constexpr std::size_t size (void) const { return N; }
+
+  constexpr std::string_view operator () (std::size_t i) const
+  {
+    return std::string_view (m_chars.data () + m_offsets[i],
+                             m_offsets[i+1] - m_offsets[i]);
+  }
+
+  constexpr validatestring_match lookup (std::string_view str) const
+  {
+    std::size_t len = str.length ();
+    if (len == 0)
+      return m_empty_answer;
+
+    for (std::size_t k = hash (str); m_slots[k] >= 0;
+         k = (k + 1) & (nslots - 1))
+      {
+        std::string_view s = folded (m_slots[k]);
+        if (s.length () == len && validatestring_prefix (str, s))
+          return m_slots[k];
+      }
+
+    for (std::size_t i = 0; i < N; i++)
+      {
+        if (validatestring_prefix (str, folded (i)))
+          return m_answers[m_offsets[i] + len - 1];
+      }
+
+    return validatestring_no_match;
+  }
+
+  // Error message for the lookup of STR that gave RESULT, as for
+  // validatestring_message.
+
+  std::string message (validatestring_match result, std::string_view errstr,
+                       std::string_view str, std::size_t limit = 0) const
+  {
+    std::array<std::string_view, N> views;
+    for (std::size_t i = 0; i < N; i++)
+      views[i] = (*this)(i);
+
+    return validatestring_message (result, errstr, str,
+                                   validatestring_string_views (views.data (),
+                                                                N),
+                                   limit);
+  }
+
+private:
+
+  static constexpr std::size_t table_size (void)
+  {
+    std::size_t n = 1;
+    while (n < 2 * N)
+      n *= 2;
+    return n;
+  }
+
+  static constexpr std::size_t nslots = table_size ();
+
+  // FNV-1a of the folded bytes of STR.
+  static constexpr std::size_t hash (std::string_view str)
+  {
+    std::uint64_t h = 14695981039346656037ULL;
+    for (std::size_t j = 0; j < str.length (); j++)
+      h = (h ^ validatestring_fold (str[j])) * 1099511628211ULL;
+    return (h ^ (h >> 32)) & (nslots - 1);
+  }
+
+  constexpr std::string_view folded (std::size_t i) const
+  {
+    return std::string_view (m_folded.data () + m_offsets[i],
+                             m_offsets[i+1] - m_offsets[i]);
+  }
+
+  // Result for the first LEN characters of string I, as by a linear scan.
+  constexpr validatestring_match answer (std::size_t i, std::size_t len) const
+  {
+    std::string_view q = folded (i).substr (0, len);
+    validatestring_match best = validatestring_no_match;
+
+    for (std::size_t k = 0; k < N; k++)
+      {
+        std::string_view s = folded (k);
+        if (s.substr (0, len) == q
+            && (best < 0 || s.length () < folded (best).length ()))
+          best = k;
+      }
+
+    for (std::size_t k = 0; k < N; k++)
+      {
+        std::string_view s = folded (k);
+        if (s.substr (0, len) == q
+            && s.substr (0, folded (best).length ()) != folded (best))
+          return validatestring_ambiguous;
+      }
+
+    return best;
+  }
+
+  std::array<char, Len> m_chars {};
+
+  std::array<char, Len> m_folded {};
+
+  std::array<std::size_t, N + 1> m_offsets {};
+
+  // Result for the first J + 1 characters of string I at m_offsets[I] + J,
+  // and for the empty string.
+  std::array<validatestring_match, Len> m_answers {};
+
+  validatestring_match m_empty_answer = validatestring_no_match;
+
+  // Index of the string in each slot, or validatestring_no_match.  The
+  // slots are probed linearly.
+  std::array<validatestring_match, nslots> m_slots {};
+};
+
+template <std::size_t... Ls>
+validatestring_fixed (const char (&... strs)[Ls])
+  -> validatestring_fixed<sizeof... (Ls), (std::size_t (0) + ... + (Ls - 1))>;
+
+#endif
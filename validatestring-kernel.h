@@ -0,0 +1,264 @@
+/*
+
+Copyright (C) 2018-2018 Gene Harvey
+
+This file is part of Octave.
+
+Octave is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Octave is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Octave; see the file COPYING.  If not, see
+<https://www.gnu.org/licenses/>.
+
+*/
+
+#if ! defined (octave_validatestring_kernel_h)
+#define octave_validatestring_kernel_h 1
+
+// Case-insensitive prefix comparison used by validatestring.  The string
+// being validated is folded once, and each candidate is then folded and
+// compared 16, 32 or 64 bytes at a time.  The widest implementation the CPU
+// supports is selected when the library is loaded.
+//
+// The filter over the packed leading bytes of many candidates is selected
+// the same way.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#if defined (__GNUC__) && (defined (__x86_64__) || defined (__i386__))
+#  define VALIDATESTRING_X86_DISPATCH 1
+#  include <immintrin.h>
+#endif
+
+// Case folding for all comparisons.  This agrees with the std::tolower used
+// by octave::string::strncmpi for the "C" locale and for any UTF-8 locale.
+
+constexpr unsigned char
+validatestring_fold (unsigned char c)
+{
+  return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+inline std::string
+validatestring_folded (std::string_view s)
+{
+  std::string retval (s.length (), '\0');
+  for (std::size_t j = 0; j < s.length (); j++)
+    retval[j] = validatestring_fold (s[j]);
+  return retval;
+}
+
+// True if the first N characters of S, once folded, equal FOLDED.  Both
+// must have at least N characters.
+
+typedef bool (*validatestring_prefix_fcn) (const char *folded, const char *s,
+                                           std::size_t n);
+
+inline bool
+validatestring_prefix_scalar (const char *folded, const char *s,
+                              std::size_t n)
+{
+  for (std::size_t j = 0; j < n; j++)
+    {
+      if (validatestring_fold (s[j]) != static_cast<unsigned char> (folded[j]))
+        return false;
+    }
+  return true;
+}
+
+#if defined (VALIDATESTRING_X86_DISPATCH)
+
+// Adding 0x80 - 'A' maps 'A' to 'Z' onto the 26 smallest signed bytes, so
+// one signed compare finds the upper case letters and 0x20 folds them.
+
+__attribute__ ((target ("sse2"))) inline bool
+validatestring_prefix_sse2 (const char *folded, const char *s, std::size_t n)
+{
+  const __m128i bias  = _mm_set1_epi8 (0x80 - 'A');
+  const __m128i limit = _mm_set1_epi8 (-0x80 + 26);
+  const __m128i flip  = _mm_set1_epi8 (0x20);
+
+  std::size_t j = 0;
+  for (; j + 16 <= n; j += 16)
+    {
+      __m128i c = _mm_loadu_si128 (reinterpret_cast<const __m128i *> (s + j));
+      __m128i f
+        = _mm_loadu_si128 (reinterpret_cast<const __m128i *> (folded + j));
+      __m128i upper = _mm_cmplt_epi8 (_mm_add_epi8 (c, bias), limit);
+      c = _mm_or_si128 (c, _mm_and_si128 (upper, flip));
+      if (_mm_movemask_epi8 (_mm_cmpeq_epi8 (c, f)) != 0xFFFF)
+        return false;
+    }
+
+  return validatestring_prefix_scalar (folded + j, s + j, n - j);
+}
+
+__attribute__ ((target ("avx2"))) inline bool
+validatestring_prefix_avx2 (const char *folded, const char *s, std::size_t n)
+{
+  const __m256i bias  = _mm256_set1_epi8 (0x80 - 'A');
+  const __m256i limit = _mm256_set1_epi8 (-0x80 + 26);
+  const __m256i flip  = _mm256_set1_epi8 (0x20);
+
+  std::size_t j = 0;
+  for (; j + 32 <= n; j += 32)
+    {
+      __m256i c
+        = _mm256_loadu_si256 (reinterpret_cast<const __m256i *> (s + j));
+      __m256i f
+        = _mm256_loadu_si256 (reinterpret_cast<const __m256i *> (folded + j));
+      __m256i upper = _mm256_cmpgt_epi8 (limit, _mm256_add_epi8 (c, bias));
+      c = _mm256_or_si256 (c, _mm256_and_si256 (upper, flip));
+      if (static_cast<unsigned int> (_mm256_movemask_epi8
+                                       (_mm256_cmpeq_epi8 (c, f)))
+          != 0xFFFFFFFFu)
+        return false;
+    }
+
+  if (j + 16 <= n)
+    return validatestring_prefix_sse2 (folded + j, s + j, n - j);
+
+  return validatestring_prefix_scalar (folded + j, s + j, n - j);
+}
+
+// With AVX-512BW the tail is handled by masked loads, which do not touch
+// the bytes beyond N.
+
+__attribute__ ((target ("avx512f,avx512bw"))) inline bool
+validatestring_prefix_avx512 (const char *folded, const char *s,
+                              std::size_t n)
+{
+  const __m512i bias  = _mm512_set1_epi8 (0x80 - 'A');
+  const __m512i limit = _mm512_set1_epi8 (-0x80 + 26);
+  const __m512i flip  = _mm512_set1_epi8 (0x20);
+
+  for (std::size_t j = 0; j < n; j += 64)
+    {
+      __mmask64 m = (n - j >= 64 ? ~__mmask64 (0)
+                                 : (__mmask64 (1) << (n - j)) - 1);
+      __m512i c = _mm512_maskz_loadu_epi8 (m, s + j);
+      __m512i f = _mm512_maskz_loadu_epi8 (m, folded + j);
+      __mmask64 upper = _mm512_cmplt_epi8_mask (_mm512_add_epi8 (c, bias),
+                                                limit);
+      c = _mm512_mask_blend_epi8 (upper, c, _mm512_or_si512 (c, flip));
+      if (_mm512_mask_cmpneq_epi8_mask (m, c, f))
+        return false;
+    }
+
+  return true;
+}
+
+#endif
+
+inline validatestring_prefix_fcn
+validatestring_select_prefix (void)
+{
+#if defined (VALIDATESTRING_X86_DISPATCH)
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("avx512bw"))
+    return validatestring_prefix_avx512;
+  if (__builtin_cpu_supports ("avx2"))
+    return validatestring_prefix_avx2;
+  if (__builtin_cpu_supports ("sse2"))
+    return validatestring_prefix_sse2;
+#endif
+  return validatestring_prefix_scalar;
+}
+
+inline const validatestring_prefix_fcn validatestring_prefix_folded
+  = validatestring_select_prefix ();
+
+// Bit K of the result is set if KEYS[K] & MASK equals KEY, for K < N.  N
+// is at most 64.
+
+typedef std::uint64_t (*validatestring_filter_fcn)
+  (const std::uint64_t *keys, std::size_t n, std::uint64_t key,
+   std::uint64_t mask);
+
+inline std::uint64_t
+validatestring_filter_scalar (const std::uint64_t *keys, std::size_t n,
+                              std::uint64_t key, std::uint64_t mask)
+{
+  std::uint64_t bits = 0;
+  for (std::size_t k = 0; k < n; k++)
+    bits |= std::uint64_t ((keys[k] & mask) == key) << k;
+  return bits;
+}
+
+#if defined (VALIDATESTRING_X86_DISPATCH)
+
+__attribute__ ((target ("avx2"))) inline std::uint64_t
+validatestring_filter_avx2 (const std::uint64_t *keys, std::size_t n,
+                            std::uint64_t key, std::uint64_t mask)
+{
+  const __m256i k = _mm256_set1_epi64x (key);
+  const __m256i m = _mm256_set1_epi64x (mask);
+
+  std::uint64_t bits = 0;
+  std::size_t j = 0;
+  for (; j + 4 <= n; j += 4)
+    {
+      __m256i c
+        = _mm256_loadu_si256 (reinterpret_cast<const __m256i *> (keys + j));
+      __m256i eq = _mm256_cmpeq_epi64 (_mm256_and_si256 (c, m), k);
+      bits |= std::uint64_t (_mm256_movemask_pd (_mm256_castsi256_pd (eq)))
+              << j;
+    }
+
+  if (j < n)
+    bits |= validatestring_filter_scalar (keys + j, n - j, key, mask) << j;
+
+  return bits;
+}
+
+__attribute__ ((target ("avx512f"))) inline std::uint64_t
+validatestring_filter_avx512 (const std::uint64_t *keys, std::size_t n,
+                              std::uint64_t key, std::uint64_t mask)
+{
+  const __m512i k = _mm512_set1_epi64 (key);
+  const __m512i m = _mm512_set1_epi64 (mask);
+
+  std::uint64_t bits = 0;
+  for (std::size_t j = 0; j < n; j += 8)
+    {
+      __mmask8 valid = (n - j >= 8 ? __mmask8 (0xFF)
+                                   : __mmask8 ((1u << (n - j)) - 1));
+      __m512i c = _mm512_maskz_loadu_epi64 (valid, keys + j);
+      bits |= std::uint64_t (_mm512_mask_cmpeq_epi64_mask
+                               (valid, _mm512_and_si512 (c, m), k))
+              << j;
+    }
+
+  return bits;
+}
+
+#endif
+
+inline validatestring_filter_fcn
+validatestring_select_filter (void)
+{
+#if defined (VALIDATESTRING_X86_DISPATCH)
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("avx512f"))
+    return validatestring_filter_avx512;
+  if (__builtin_cpu_supports ("avx2"))
+    return validatestring_filter_avx2;
+#endif
+  return validatestring_filter_scalar;
+}
+
+inline const validatestring_filter_fcn validatestring_filter
+  = validatestring_select_filter ();
+
+#endif
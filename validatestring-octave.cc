@@ -0,0 +1,1422 @@
+/*
+
+Copyright (C) 2018-2018 Gene Harvey
+
+This file is part of Octave.
+
+Octave is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Octave is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Octave; see the file COPYING.  If not, see
+<https://www.gnu.org/licenses/>.
+
+*/
+
+#if defined (HAVE_CONFIG_H)
+#  include "config.h"
+#endif
+
+#include "octave-config.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <limits>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Cell.h"
+#include "dNDArray.h"
+#include "defun.h"
+#include "error.h"
+#include "interpreter.h"
+#include "ov-base.h"
+#include "ov-ch-mat.h"
+#include "ovl.h"
+#include "quit.h"
+#include "variables.h"
+
+#include "validatestring-engine.h"
+#include "validatestring-octave.h"
+
+// Maximum number of bytes taken by the indices in the lookup cache.
+static double Vvalidatestring_cache_size = 64 << 20;
+
+// Maximum number of elements listed in an error message, 0 for no limit.
+static int Vvalidatestring_list_limit = 100;
+
+// Maximum number of threads used to search a large STRARRAY, 0 for one per
+// core.
+static int Vvalidatestring_threads = 0;
+
+// View of the characters of the string value OV, without copying them out
+// of its charNDArray.  Values that are not row vectors are rare, and are
+// converted by string_value () into BUF to keep its semantics.
+
+static std::string_view
+validatestring_view (const octave_value& ov, std::string& buf)
+{
+  const octave_char_matrix *chm
+    = dynamic_cast<const octave_char_matrix *> (&ov.get_rep ());
+
+  if (chm)
+    {
+      const charNDArray& chars = chm->matrix_ref ();
+      if (chars.ndims () == 2 && chars.rows () <= 1)
+        return std::string_view (chars.data (), chars.numel ());
+    }
+
+  buf = ov.string_value ();
+  return buf;
+}
+
+// True if OV is a single row vector, without copying its dimensions.
+
+static bool
+validatestring_is_row (const octave_value& ov)
+{
+  const octave_char_matrix *chm
+    = dynamic_cast<const octave_char_matrix *> (&ov.get_rep ());
+
+  if (chm)
+    {
+      const dim_vector& dv = chm->matrix_ref ().dims ();
+      return dv.ndims () == 2 && dv(0) == 1;
+    }
+
+  return ov.ndims () == 2 && ov.rows () == 1;
+}
+
+// The elements of a cellstr as seen by the matching engine.  Elements that
+// are not row vectors keep their converted copies here, under a lock.  The
+// conversion may raise warnings or errors, so a cellstr with such elements
+// must only be read by the interpreter thread (see
+// validatestring_scan_threads).
+
+class validatestring_cell : public validatestring_strings
+{
+public:
+
+  validatestring_cell (const Cell& cell) : m_cell (cell) { }
+
+  std::size_t size (void) const { return m_cell.numel (); }
+
+  std::string_view operator () (std::size_t i) const
+  {
+    std::string buf;
+    std::string_view s = validatestring_view (m_cell(i), buf);
+    if (s.data () != buf.data ())
+      return s;
+    std::lock_guard<std::mutex> lock (m_mutex);
+    m_bufs.push_back (std::move (buf));
+    return m_bufs.back ();
+  }
+
+private:
+
+  Cell m_cell;
+
+  mutable std::deque<std::string> m_bufs;
+
+  mutable std::mutex m_mutex;
+};
+
+// Number of threads for validatestring_scan of STRARRAY: one if any element
+// would need to be converted, and up to Vvalidatestring_threads otherwise.
+// Arrays too small to be split are not checked.
+
+static std::size_t
+validatestring_scan_threads (const Cell& strarray)
+{
+  octave_idx_type n = strarray.numel ();
+
+  if (static_cast<std::size_t> (n) < 2 * validatestring_min_thread_strs)
+    return 1;
+
+  for (octave_idx_type i = 0; i < n; i++)
+    {
+      const octave_char_matrix *chm
+        = dynamic_cast<const octave_char_matrix *> (&strarray(i).get_rep ());
+
+      if (! chm || chm->matrix_ref ().ndims () != 2
+          || chm->matrix_ref ().rows () > 1)
+        return 1;
+    }
+
+  return Vvalidatestring_threads;
+}
+
+// The elements of a cellstr STR being validated, as seen by the matching
+// engine.  Only row vectors are valid, so other elements are seen as empty
+// and rejected before their results are used.  Nothing is converted, which
+// lets several threads read the elements.
+
+class validatestring_queries : public validatestring_strings
+{
+public:
+
+  validatestring_queries (const Cell& cell) : m_cell (cell) { }
+
+  std::size_t size (void) const { return m_cell.numel (); }
+
+  std::string_view operator () (std::size_t i) const
+  {
+    const octave_char_matrix *chm
+      = dynamic_cast<const octave_char_matrix *> (&m_cell(i).get_rep ());
+
+    if (chm)
+      {
+        const charNDArray& chars = chm->matrix_ref ();
+        if (chars.ndims () == 2 && chars.rows () == 1)
+          return std::string_view (chars.data (), chars.numel ());
+      }
+
+    return std::string_view ();
+  }
+
+private:
+
+  Cell m_cell;
+};
+
+// Opaque value returned by validatestring_compile.  Copies share the index.
+
+class octave_validatestring_index : public octave_base_value
+{
+public:
+
+  octave_validatestring_index (void)
+    : octave_base_value (), m_strarray (), m_index (), m_byte_size (0)
+  { }
+
+  octave_validatestring_index
+    (const Cell& strarray,
+     const std::shared_ptr<const validatestring_index>& index)
+    : octave_base_value (), m_strarray (strarray), m_index (index),
+      m_byte_size (index->byte_size ())
+  {
+    for (octave_idx_type i = 0; i < m_strarray.numel (); i++)
+      m_byte_size += m_strarray(i).byte_size ();
+  }
+
+  octave_base_value * clone (void) const
+  { return new octave_validatestring_index (*this); }
+
+  octave_base_value * empty_clone (void) const
+  { return new octave_validatestring_index (); }
+
+  dim_vector dims (void) const { return dim_vector (1, 1); }
+
+  bool is_defined (void) const { return true; }
+
+  bool is_constant (void) const { return true; }
+
+  // The index and the strings it refers to, as shown by whos.
+  std::size_t byte_size (void) const { return m_byte_size; }
+
+  const Cell& strarray (void) const { return m_strarray; }
+
+  std::shared_ptr<const validatestring_index> index (void) const
+  { return m_index; }
+
+  void print (std::ostream& os, bool pr_as_read_syntax = false);
+
+  void print_raw (std::ostream& os, bool pr_as_read_syntax = false) const;
+
+  bool print_as_scalar (void) const { return true; }
+
+private:
+
+  Cell m_strarray;
+
+  std::shared_ptr<const validatestring_index> m_index;
+
+  std::size_t m_byte_size;
+
+  DECLARE_OV_TYPEID_FUNCTIONS_AND_DATA
+};
+
+void
+octave_validatestring_index::print (std::ostream& os, bool pr_as_read_syntax)
+{
+  print_raw (os, pr_as_read_syntax);
+  newline (os);
+}
+
+void
+octave_validatestring_index::print_raw (std::ostream& os, bool) const
+{
+  indent (os);
+  os << "<validatestring index of " << m_strarray.numel () << " strings>";
+}
+
+DEFINE_OV_TYPEID_FUNCTIONS_AND_DATA (octave_validatestring_index,
+                                     "validatestring_index",
+                                     "validatestring_index");
+
+// LRU cache of sorted indices for cellstr STRARRAY arguments, bounded by the
+// memory they take.  A cellstr is first only recorded and gets its index when
+// it is seen again, so one-off calls never pay for building one.  Every
+// entry is charged the size of its index from the time it is recorded, and
+// a cellstr whose index would not fit at all is never recorded.  Entries
+// are found by the identity of the Cell data, which cannot change while the
+// cache holds a reference to it, and otherwise by a hash of the contents.
+// A content hit takes over the identity of the new Cell, as literals produce
+// a new Cell every time.
+
+class validatestring_cache
+{
+public:
+
+  validatestring_cache (void) = default;
+
+  validatestring_cache (const validatestring_cache&) = delete;
+
+  validatestring_cache& operator = (const validatestring_cache&) = delete;
+
+  // The index of CELL, if it is cached.  If BUILD is true, an index is
+  // always returned, and built for this call alone if CELL is not cached.
+
+  std::shared_ptr<const validatestring_index>
+  lookup (const Cell& cell, std::size_t budget, bool build);
+
+  void trim (std::size_t budget);
+
+  void clear (void) { trim (0); }
+
+private:
+
+  typedef std::pair<const octave_value *, octave_idx_type> rep_key;
+
+  struct rep_key_hash
+  {
+    std::size_t operator () (const rep_key& k) const
+    {
+      return (std::hash<const octave_value *> () (k.first)
+              ^ std::hash<octave_idx_type> () (k.second));
+    }
+  };
+
+  struct entry
+  {
+    Cell                                        cell;
+    std::size_t                                 hash;
+    std::size_t                                 bytes;
+    std::shared_ptr<const validatestring_index> index;
+  };
+
+  typedef std::list<entry>::iterator entry_iterator;
+
+  static rep_key key (const Cell& cell)
+  { return rep_key (cell.data (), cell.numel ()); }
+
+  static std::size_t estimated_byte_size (const Cell& cell);
+
+  void erase (entry_iterator it);
+
+  std::list<entry> m_entries;
+
+  std::unordered_map<rep_key, entry_iterator, rep_key_hash> m_by_rep;
+
+  std::unordered_multimap<std::size_t, entry_iterator> m_by_hash;
+
+  std::size_t m_bytes = 0;
+};
+
+std::shared_ptr<const validatestring_index>
+validatestring_cache::lookup (const Cell& cell, std::size_t budget,
+                              bool build)
+{
+  entry_iterator it;
+
+  trim (budget);
+
+  auto rep_it = m_by_rep.find (key (cell));
+  if (rep_it != m_by_rep.end ())
+    it = rep_it->second;
+  else
+    {
+      std::size_t bytes = estimated_byte_size (cell);
+
+      if (bytes > budget)
+        {
+          if (build)
+            return std::make_shared<const validatestring_sorted_index>
+                     (validatestring_cell (cell));
+          return nullptr;
+        }
+
+      validatestring_cell strs (cell);
+      std::size_t h = validatestring_hash (strs);
+      auto range = m_by_hash.equal_range (h);
+      auto hash_it = range.first;
+      while (hash_it != range.second
+             && ! validatestring_equal (validatestring_cell
+                                          (hash_it->second->cell), strs))
+        hash_it++;
+
+      if (hash_it == range.second)
+        {
+          trim (budget - bytes);
+          m_entries.push_front (entry {cell, h, bytes, nullptr});
+          m_by_rep.emplace (key (cell), m_entries.begin ());
+          m_by_hash.emplace (h, m_entries.begin ());
+          m_bytes += bytes;
+          if (! build)
+            return nullptr;
+          it = m_entries.begin ();
+        }
+      else
+        {
+          it = hash_it->second;
+          m_by_rep.erase (key (it->cell));
+          it->cell = cell;
+          m_by_rep.emplace (key (cell), it);
+        }
+    }
+
+  m_entries.splice (m_entries.begin (), m_entries, it);
+
+  std::shared_ptr<const validatestring_index> index = it->index;
+
+  if (! index)
+    {
+      index = std::make_shared<const validatestring_sorted_index>
+                (validatestring_cell (it->cell));
+      it->index = index;
+      m_bytes += index->byte_size () - it->bytes;
+      it->bytes = index->byte_size ();
+      trim (budget);
+    }
+
+  return index;
+}
+
+void
+validatestring_cache::trim (std::size_t budget)
+{
+  while (m_bytes > budget)
+    erase (std::prev (m_entries.end ()));
+}
+
+// The size of the index of CELL, without reading the strings.
+
+std::size_t
+validatestring_cache::estimated_byte_size (const Cell& cell)
+{
+  octave_idx_type n = cell.numel ();
+  std::size_t len = 0;
+
+  for (octave_idx_type i = 0; i < n; i++)
+    len += cell(i).numel ();
+
+  return validatestring_sorted_index::estimated_byte_size (n, len);
+}
+
+void
+validatestring_cache::erase (entry_iterator it)
+{
+  auto range = m_by_hash.equal_range (it->hash);
+  for (auto hash_it = range.first; hash_it != range.second; hash_it++)
+    {
+      if (hash_it->second == it)
+        {
+          m_by_hash.erase (hash_it);
+          break;
+        }
+    }
+  m_by_rep.erase (key (it->cell));
+  m_bytes -= it->bytes;
+  m_entries.erase (it);
+}
+
+static validatestring_cache&
+validatestring_cache_instance (void)
+{
+  static validatestring_cache cache;
+  return cache;
+}
+
+// Vvalidatestring_cache_size as a number of bytes.
+
+static std::size_t
+validatestring_cache_budget (void)
+{
+  if (! (Vvalidatestring_cache_size > 0))
+    return 0;
+  else if (Vvalidatestring_cache_size
+           >= static_cast<double> (std::numeric_limits<std::size_t>::max ()))
+    return std::numeric_limits<std::size_t>::max ();
+
+  return Vvalidatestring_cache_size;
+}
+
+// Index of kind KIND over STRARRAY, for validatestring_compile.
+
+static std::shared_ptr<const validatestring_index>
+validatestring_make_index (const Cell& strarray, const std::string& kind)
+{
+  validatestring_cell strs (strarray);
+
+  if (kind == "trie")
+    return std::make_shared<const validatestring_trie> (strs);
+  else if (kind == "sorted")
+    return std::make_shared<const validatestring_sorted_index> (strs);
+  else if (kind == "double-array")
+    return std::make_shared<const validatestring_dat_index> (strs);
+  else if (kind == "front-coded")
+    return std::make_shared<const validatestring_front_coded_index> (strs);
+  else if (kind == "bit-sliced")
+    return std::make_shared<const validatestring_bitslice_index> (strs);
+  else if (kind == "packed")
+    return std::make_shared<const validatestring_packed_index> (strs);
+
+  error ("validatestring_compile: unknown index KIND '%s'", kind.c_str ());
+}
+
+// The validated element of STRARRAY.  Row vectors are returned as they are,
+// sharing their data with STRARRAY.
+
+static octave_value
+validatestring_result (const Cell& strarray, octave_idx_type idx)
+{
+  const octave_value& elt = strarray(idx);
+
+  if (validatestring_is_row (elt))
+    return elt;
+
+  return octave_value (elt.string_value ());
+}
+
+// Append a list of the elements of STRARRAY to MSG, bounded by
+// Vvalidatestring_list_limit.
+
+static void
+validatestring_append_list (std::string& msg, std::string_view str,
+                            const Cell& strarray, bool matches_only)
+{
+  validatestring_append_list (msg, str, validatestring_cell (strarray),
+                              matches_only, Vvalidatestring_list_limit);
+}
+
+static std::string
+validatestring_errstr (const octave_value& ov_funcname,
+                       const octave_value& ov_varname,
+                       const std::string& name, octave_idx_type position)
+{
+  return validatestring_errstr (ov_funcname.isempty ()
+                                ? "" : ov_funcname.string_value (),
+                                ov_varname.isempty ()
+                                ? "" : ov_varname.string_value (),
+                                name, position > 0 ? position : 0);
+}
+
+// True if N lookups in STRARRAY are expected to be faster with an index
+// built for them than with a scan of STRARRAY for each.  Building a sorted
+// index takes as long as 60 to 110 scans, for any size of STRARRAY, which
+// this bound keeps below.
+
+static bool
+validatestring_build_index (octave_idx_type n, const Cell& strarray)
+{
+  std::size_t log2_size = 0;
+
+  while ((std::size_t (1) << log2_size)
+         < static_cast<std::size_t> (strarray.numel ()))
+    log2_size++;
+
+  return static_cast<std::size_t> (n) > 4 * log2_size;
+}
+
+// Validate every element of the cellstr STRS against STRARRAY, using its
+// INDEX if there is one and scanning STRARRAY for each element otherwise.
+// The lookups may be shared among threads, and their results are then
+// converted in order.  All invalid elements are reported together once
+// the whole array has been processed.  The indices of the matches are only
+// returned if NARGOUT > 1.  If NARGOUT > 2 there is no error, and the status
+// of every element is returned instead.
+
+static octave_value_list
+validatestring_batch (const Cell& strs, const Cell& strarray,
+                      const validatestring_index *index,
+                      const octave_value& ov_funcname,
+                      const octave_value& ov_varname,
+                      octave_idx_type position, int nargout)
+{
+  octave_idx_type i;
+  octave_idx_type n = strs.numel ();
+  octave_idx_type nfailures = 0;
+  bool            any_no_match = false;
+
+  std::vector<std::pair<octave_idx_type, validatestring_match>> failures;
+
+  std::vector<validatestring_match> results (n);
+
+  std::size_t max_failures = (Vvalidatestring_list_limit > 0
+                              ? Vvalidatestring_list_limit : n);
+
+  bool    nothrow = (nargout > 2);
+  Cell    retval (strs.dims ());
+  NDArray idx (nargout > 1 ? strs.dims () : dim_vector (0, 0));
+  NDArray status (nothrow ? strs.dims () : dim_vector (0, 0));
+  double *pidx = idx.fortran_vec ();
+  double *pstatus = status.fortran_vec ();
+
+  if (index)
+    validatestring_lookup_all (*index, validatestring_queries (strs),
+                               results.data (), Vvalidatestring_threads,
+                               [] (void) { octave_quit (); });
+  else
+    {
+      validatestring_queries queries (strs);
+      validatestring_cell strarray_strs (strarray);
+      std::size_t nthreads = validatestring_scan_threads (strarray);
+
+      for (i = 0; i < n; i++)
+        {
+          octave_quit ();
+          results[i] = validatestring_scan (queries(i), strarray_strs,
+                                            nthreads);
+        }
+    }
+
+  for (i = 0; i < n; i++)
+    {
+      if ((i & 0xFFF) == 0)
+        octave_quit ();
+
+      const octave_value& elt = strs(i);
+
+      if (! validatestring_is_row (elt))
+        error ("validatestring: STR{%" OCTAVE_IDX_TYPE_FORMAT
+               "} must be a single row vector", i + 1);
+
+      validatestring_match result = results[i];
+
+      if (nothrow)
+        pstatus[i] = validatestring_status (result);
+
+      if (result >= 0)
+        {
+          retval(i) = validatestring_result (strarray, result);
+          if (nargout > 1)
+            pidx[i] = static_cast<double> (result + 1);
+        }
+      else if (nothrow)
+        {
+          retval(i) = octave_value ("");
+          pidx[i] = 0;
+        }
+      else
+        {
+          nfailures++;
+          any_no_match |= (result == validatestring_no_match);
+          if (failures.size () < max_failures)
+            failures.push_back (std::make_pair (i, result));
+        }
+    }
+
+  if (nfailures > 0)
+    {
+      std::string msg = validatestring_errstr (ov_funcname, ov_varname,
+                                               "STR", position);
+
+      msg += "has " + std::to_string (nfailures) + " invalid element"
+             + (nfailures > 1 ? "s:" : ":");
+
+      for (const auto& f : failures)
+        {
+          std::string str = strs(f.first).string_value ();
+
+          msg += "\n  '" + str + "' (element " + std::to_string (f.first + 1)
+                 + ") ";
+          if (f.second == validatestring_no_match)
+            msg += "does not match any valid value";
+          else
+            {
+              msg += "allows multiple unique matches: ";
+              validatestring_append_list (msg, str, strarray, true);
+            }
+        }
+
+      if (failures.size () < static_cast<std::size_t> (nfailures))
+        msg += "\n  ... and "
+               + std::to_string (nfailures - failures.size ()) + " more";
+
+      if (any_no_match)
+        {
+          msg += "\nvalid values are:\n";
+          validatestring_append_list (msg, "", strarray, false);
+        }
+
+      error ("validatestring: %s", msg.c_str ());
+    }
+
+  if (nothrow)
+    return ovl (retval, idx, status);
+  else if (nargout > 1)
+    return ovl (retval, idx);
+
+  return ovl (retval);
+}
+
+octave_value_list
+validatestring_do_validatestring (const octave_value_list& args,
+                                  int nargout)
+{
+  octave_idx_type    i;
+
+  octave_value       ov_str;
+  octave_value       ov_strarray;
+  octave_value       ov_funcname;
+  octave_value       ov_varname;
+
+  std::string_view   str;
+  std::string        buf;
+  std::string        funcname_buf;
+  std::string        varname_buf;
+  std::string        msg;
+  Cell               strarray;
+
+  validatestring_context context;
+  validatestring_match result;
+  bool               is_index;
+  bool               is_batch;
+
+  std::shared_ptr<const validatestring_index> index;
+
+  int             ncharin  = 0;
+  octave_idx_type nargin   = args.length ();
+  octave_idx_type position = 0;
+
+  if (nargin < 2 || nargin > 5)
+    print_usage ();
+
+  ov_str      = args(0);
+  ov_strarray = args(1);
+
+  is_index = (ov_strarray.type_id ()
+              == octave_validatestring_index::static_type_id ());
+  is_batch = ov_str.iscellstr ();
+
+  for (i = 2; i < nargin; i++)
+    {
+      if (args(i).is_string ())
+        {
+          switch (ncharin)
+            {
+              case 0:
+                {
+                  ov_funcname = args(i);
+                  break;
+                }
+              case 1:
+                {
+                  ov_varname = args (i);
+                  break;
+                }
+              default:
+                error ("validatestring: invalid number of character inputs "
+                       "(3)");
+            }
+          ncharin++;
+        }
+    }
+
+  if (nargin > 2 && args(nargin - 1).isnumeric ())
+    {
+      position = (args(nargin - 1).fix ()).idx_type_value ();
+    }
+
+  if (!ov_str.is_string () && !is_batch)
+    {
+      error ("validatestring: STR must be a character string or cellstr");
+    }
+  else if (!is_batch
+           && (ov_str.ndims () != 2 || ov_str.dims ()(0) != 1))
+    {
+      error ("validatestring: STR must be a single row vector");
+    }
+  else if (!is_index && ov_strarray.isempty ())
+    {
+      error ("validatestring: STRARRAY must be non-empty");
+    }
+  else if (!is_index && !ov_strarray.iscellstr ())
+    {
+      error ("validatestring: STRARRAY must be a cellstr");
+    }
+  else if (!ov_funcname.isempty ()
+           && (ov_funcname.ndims () != 2 || ov_funcname.dims ()(0) != 1))
+    {
+      error ("validatestring: FUNCNAME must be a single row vector");
+    }
+  else if (!ov_varname.isempty ()
+           && (ov_varname.ndims () != 2 || ov_varname.dims ()(0) != 1))
+    {
+      error ("validatestring: VARNAME must be a single row vector");
+    }
+  else if (position < 0)
+    {
+      error ("validatestring: POSITION must be >= 0");
+    }
+
+  if (is_index)
+    {
+      const octave_validatestring_index& compiled
+        = dynamic_cast<const octave_validatestring_index&>
+            (ov_strarray.get_rep ());
+
+      index    = compiled.index ();
+      strarray = compiled.strarray ();
+    }
+  else
+    {
+      strarray = ov_strarray.cell_value ();
+      index    = validatestring_cache_instance ().lookup
+                   (strarray, validatestring_cache_budget (),
+                    is_batch && validatestring_build_index (ov_str.numel (),
+                                                            strarray));
+    }
+
+  if (is_batch)
+    return validatestring_batch (ov_str.cell_value (), strarray,
+                                 index.get (), ov_funcname, ov_varname,
+                                 position, nargout);
+
+  str = validatestring_view (ov_str, buf);
+
+  if (!ov_funcname.isempty ())
+    context.funcname = validatestring_view (ov_funcname, funcname_buf);
+  if (!ov_varname.isempty ())
+    context.varname = validatestring_view (ov_varname, varname_buf);
+  context.position = position;
+  context.limit    = Vvalidatestring_list_limit;
+
+  result = validatestring_validate (str, validatestring_cell (strarray),
+                                    index.get (),
+                                    nargout > 2 ? nullptr : &msg, context,
+                                    index ? 1
+                                          : validatestring_scan_threads
+                                              (strarray));
+
+  if (nargout > 2)
+    {
+      if (result >= 0)
+        return ovl (validatestring_result (strarray, result),
+                    static_cast<double> (result + 1),
+                    validatestring_status (result));
+
+      return ovl ("", 0.0, validatestring_status (result));
+    }
+
+  if (result >= 0)
+    {
+      if (nargout > 1)
+        return ovl (validatestring_result (strarray, result),
+                    static_cast<double> (result + 1));
+
+      return ovl (validatestring_result (strarray, result));
+    }
+
+  error ("%s", msg.c_str ());
+}
+
+octave_value_list
+validatestring_do_compile (octave::interpreter& interp,
+                           const octave_value_list& args)
+{
+  static bool type_loaded = false;
+
+  int nargin = args.length ();
+
+  if (nargin < 1 || nargin > 2)
+    print_usage ();
+
+  octave_value ov_strarray = args(0);
+  std::string  kind = "trie";
+
+  if (ov_strarray.isempty ())
+    error ("validatestring_compile: STRARRAY must be non-empty");
+  else if (!ov_strarray.iscellstr ())
+    error ("validatestring_compile: STRARRAY must be a cellstr");
+
+  if (nargin > 1)
+    kind = args(1).xstring_value ("validatestring_compile: KIND must be "
+                                  "a string");
+
+  Cell strarray = ov_strarray.cell_value ();
+  std::shared_ptr<const validatestring_index> index
+    = validatestring_make_index (strarray, kind);
+
+  if (! type_loaded)
+    {
+      octave_validatestring_index::register_type (interp.get_type_info ());
+      type_loaded = true;
+    }
+
+  return octave_value (new octave_validatestring_index (strarray, index));
+}
+
+octave_value_list
+validatestring_do_cache_size (const octave_value_list& args, int nargout)
+{
+  octave_value retval = set_internal_variable (Vvalidatestring_cache_size,
+                                               args, nargout,
+                                               "validatestring_cache_size", 0);
+
+  validatestring_cache_instance ().trim (validatestring_cache_budget ());
+
+  return retval;
+}
+
+octave_value_list
+validatestring_do_cache_clear (const octave_value_list& args)
+{
+  if (args.length () != 0)
+    print_usage ();
+
+  validatestring_cache_instance ().clear ();
+
+  return ovl ();
+}
+
+octave_value_list
+validatestring_do_list_limit (const octave_value_list& args, int nargout)
+{
+  return set_internal_variable (Vvalidatestring_list_limit, args, nargout,
+                                "validatestring_list_limit", 0);
+}
+
+octave_value_list
+validatestring_do_threads (const octave_value_list& args, int nargout)
+{
+  return set_internal_variable (Vvalidatestring_threads, args, nargout,
+                                "validatestring_threads", 0);
+}
+
+// C++ literals for the byte C and the string S, for validatestring_codegen.
+
+static std::string
+validatestring_c_char (unsigned char c)
+{
+  if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_')
+    return std::string ("'") + static_cast<char> (c) + "'";
+
+  return std::to_string (c);
+}
+
+static std::string
+validatestring_c_string (std::string_view s)
+{
+  std::string lit = "\"";
+
+  for (unsigned char c : s)
+    {
+      if (c == '"' || c == '\\')
+        {
+          lit += '\\';
+          lit += c;
+        }
+      else if (c >= 0x20 && c < 0x7f)
+        lit += c;
+      else
+        {
+          char buf[5];
+          std::snprintf (buf, sizeof (buf), "\\%03o", c);
+          lit += buf;
+        }
+    }
+
+  return lit + '"';
+}
+
+// Append to CODE the statements that return the result for a query of N >=
+// DEPTH bytes at S, whose first DEPTH bytes are shared by the folded strings
+// FOLDED(ORDER[LO]) to FOLDED(ORDER[HI-1]).  These are sorted and distinct,
+// and ORDER gives the first element of STRARRAY equal to each.  INDEX gives
+// the result for a prefix.  Bytes shared by all the strings do not change the
+// result until the end of the shortest, so they are compared as a run, and
+// the rest of the last remaining string as a tail.
+
+static void
+validatestring_codegen_node (std::string& code, const std::string& name,
+                             const validatestring_strings& folded,
+                             const std::vector<std::size_t>& order,
+                             std::size_t lo, std::size_t hi,
+                             std::size_t depth,
+                             const validatestring_index& index,
+                             std::size_t indent)
+{
+  std::string pad (indent, ' ');
+  std::string_view first = folded(order[lo]);
+  std::string_view last = folded(order[hi-1]);
+  std::string d = std::to_string (depth);
+
+  if (hi - lo == 1)
+    {
+      std::string idx = std::to_string (order[lo]);
+      if (first.length () == depth)
+        code += pad + "return (n == " + d + " ? " + idx + " : -1);\n";
+      else
+        code += (pad + "return (n <= " + std::to_string (first.length ())
+                 + " && " + name + "_tail (s + " + d + ", n - " + d + ", "
+                 + validatestring_c_string (first.substr (depth)) + ")\n"
+                 + pad + "        ? " + idx + " : -1);\n");
+      return;
+    }
+
+  std::size_t end = depth;
+  while (end < first.length () && first[end] == last[end])
+    end++;
+
+  std::string answer = std::to_string (index.lookup (first.substr (0,
+                                                                  depth)));
+
+  if (end > depth)
+    {
+      std::string e = std::to_string (end);
+      std::string run = validatestring_c_string (first.substr (depth,
+                                                               end - depth));
+      code += (pad + "if (n < " + e + ")\n"
+               + pad + "  return (" + name + "_tail (s + " + d + ", n - " + d
+               + ", " + run + ") ? " + answer + " : -1);\n"
+               + pad + "if (! " + name + "_tail (s + " + d + ", "
+               + std::to_string (end - depth) + ", " + run + "))\n"
+               + pad + "  return -1;\n");
+      depth = end;
+      d = e;
+      answer = std::to_string (index.lookup (first.substr (0, depth)));
+    }
+
+  code += pad + "if (n == " + d + ")\n" + pad + "  return " + answer + ";\n";
+
+  if (first.length () == depth)
+    lo++;
+
+  code += pad + "switch (" + name + "_fold (s[" + d + "]))\n" + pad + "  {\n";
+
+  while (lo < hi)
+    {
+      char c = folded(order[lo])[depth];
+      std::size_t next = lo + 1;
+      while (next < hi && folded(order[next])[depth] == c)
+        next++;
+
+      code += (pad + "  case " + validatestring_c_char (c) + ":\n"
+               + pad + "    {\n");
+      validatestring_codegen_node (code, name, folded, order, lo, next,
+                                   depth + 1, index, indent + 6);
+      code += pad + "    }\n";
+      lo = next;
+    }
+
+  code += pad + "  default:\n" + pad + "    return -1;\n" + pad + "  }\n";
+}
+
+// Source of the oct-file written by validatestring_codegen, to be expanded
+// with @NAME@, @N@, @STRS@, @LENS@, @TYPES@ and @MATCH@.
+
+static const char *validatestring_codegen_template = R"(// Generated by validatestring_codegen from @N@ strings.  Do not edit.
+
+#include <algorithm>
+#include <string>
+
+#include <octave/oct.h>
+#include <octave/parse.h>
+
+static const char *const @NAME@_strs[] =
+{
+@STRS@};
+
+static const std::size_t @NAME@_lens[] =
+{
+@LENS@};
+
+// Quote type of each string that is a row vector, or 0 for an empty string
+// that is not, which validatestring returns as "".
+
+static const char @NAME@_types[] =
+{
+@TYPES@};
+
+static inline unsigned char
+@NAME@_fold (unsigned char c)
+{
+  return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+// True if the N bytes at S, once folded, are the first N bytes of T.
+
+static inline bool
+@NAME@_tail (const char *s, std::size_t n, const char *t)
+{
+  for (std::size_t j = 0; j < n; j++)
+    {
+      if (@NAME@_fold (s[j]) != static_cast<unsigned char> (t[j]))
+        return false;
+    }
+
+  return true;
+}
+
+// Index of the element validated by the N bytes at S, -1 if there is no
+// match, or -2 if the match is ambiguous.
+
+static octave_idx_type
+@NAME@_match (const char *s, std::size_t n)
+{
+@MATCH@}
+
+static const Cell&
+@NAME@_strarray (void)
+{
+  static Cell strarray;
+
+  if (strarray.isempty ())
+    {
+      strarray = Cell (1, @N@);
+      for (octave_idx_type i = 0; i < @N@; i++)
+        {
+          if (@NAME@_types[i])
+            {
+              charNDArray chars (dim_vector (1, @NAME@_lens[i]));
+              std::copy (@NAME@_strs[i], @NAME@_strs[i] + @NAME@_lens[i],
+                         chars.fortran_vec ());
+              strarray(i) = octave_value (chars, @NAME@_types[i]);
+            }
+          else
+            strarray(i) = "";
+        }
+    }
+
+  return strarray;
+}
+
+// True if validatestring raises no error for the arguments after STR.
+
+static bool
+@NAME@_valid_options (const octave_value_list& args)
+{
+  int nargin = args.length ();
+  int ncharin = 0;
+
+  if (nargin > 4)
+    return false;
+
+  for (int i = 1; i < nargin; i++)
+    {
+      if (args(i).is_string ()
+          && (++ncharin > 2
+              || (! args(i).isempty ()
+                  && (args(i).ndims () != 2 || args(i).rows () != 1))))
+        return false;
+    }
+
+  if (nargin > 1 && args(nargin-1).isnumeric ())
+    {
+      const octave_value& pos = args(nargin-1);
+      if (pos.iscomplex () || pos.numel () != 1
+          || ! (pos.fix ().double_value () >= 0))
+        return false;
+    }
+
+  return true;
+}
+
+DEFUN_DLD (@NAME@, args, nargout, "-*- texinfo -*-\n\
+@deftypefn {} {[@var{validstr}, @var{idx}, @var{status}] =} @NAME@ (@var{str}, @dots{})\n\
+Same as @code{validatestring (@var{str}, @var{strarray}, @dots{})} for the\n\
+@N@ strings given to @code{validatestring_codegen}.\n\
+@seealso{validatestring}\n\
+@end deftypefn ")
+{
+  int nargin = args.length ();
+
+  if (nargin < 1)
+    print_usage ();
+
+  const octave_value& ov_str = args(0);
+
+  if (ov_str.is_string () && ov_str.ndims () == 2 && ov_str.rows () == 1
+      && @NAME@_valid_options (args))
+    {
+      std::string str = ov_str.string_value ();
+      octave_idx_type idx = @NAME@_match (str.data (), str.length ());
+
+      if (idx >= 0)
+        return ovl (@NAME@_strarray ()(idx), static_cast<double> (idx + 1),
+                    1);
+    }
+
+  // Errors, and cellstr STR, are left to validatestring.
+  octave_value_list vargs (nargin + 1, octave_value ());
+  vargs(0) = ov_str;
+  vargs(1) = @NAME@_strarray ();
+  for (int i = 1; i < nargin; i++)
+    vargs(i+1) = args(i);
+
+  return octave::feval ("validatestring", vargs, nargout);
+}
+)";
+
+// TEMPLATE with each @KEY@ in VARS replaced by its value.
+
+static std::string
+validatestring_expand (std::string_view tmpl,
+                       const std::vector<std::pair<std::string,
+                                                   std::string>>& vars)
+{
+  std::string retval;
+
+  while (! tmpl.empty ())
+    {
+      auto var = std::find_if (vars.begin (), vars.end (),
+                               [tmpl] (const auto& v)
+                               {
+                                 return (tmpl.substr (0, v.first.length ())
+                                         == v.first);
+                               });
+
+      if (var == vars.end ())
+        {
+          retval += tmpl[0];
+          tmpl.remove_prefix (1);
+        }
+      else
+        {
+          retval += var->second;
+          tmpl.remove_prefix (var->first.length ());
+        }
+    }
+
+  return retval;
+}
+
+octave_value_list
+validatestring_do_codegen (const octave_value_list& args, int nargout)
+{
+  if (args.length () != 2)
+    print_usage ();
+
+  octave_value ov_strarray = args(0);
+
+  if (ov_strarray.isempty ())
+    error ("validatestring_codegen: STRARRAY must be non-empty");
+  else if (!ov_strarray.iscellstr ())
+    error ("validatestring_codegen: STRARRAY must be a cellstr");
+
+  std::string name = args(1).xstring_value ("validatestring_codegen: NAME "
+                                            "must be a string");
+
+  bool valid_name = (! name.empty ()
+                     && ! std::isdigit (static_cast<unsigned char> (name[0])));
+  for (char c : name)
+    valid_name &= (std::isalnum (static_cast<unsigned char> (c)) || c == '_');
+
+  if (! valid_name)
+    error ("validatestring_codegen: NAME must be a valid function name");
+  else if (name == "validatestring")
+    error ("validatestring_codegen: NAME must not be validatestring, which "
+           "the generated function calls");
+
+  Cell strarray = ov_strarray.cell_value ();
+  octave_idx_type n = strarray.numel ();
+
+  for (octave_idx_type i = 0; i < n; i++)
+    {
+      if (! validatestring_is_row (strarray(i)) && ! strarray(i).isempty ())
+        error ("validatestring_codegen: elements of STRARRAY must be "
+               "single row vectors");
+    }
+
+  validatestring_cell strs (strarray);
+  validatestring_trie trie (strs);
+
+  validatestring_arena folded (strs, true);
+  std::vector<std::size_t> order = validatestring_distinct_order (folded);
+  std::string strs_code;
+  std::string lens_code;
+  std::string types_code;
+
+  for (octave_idx_type i = 0; i < n; i++)
+    {
+      strs_code += "  " + validatestring_c_string (strs(i)) + ",\n";
+      lens_code += "  " + std::to_string (strs(i).length ()) + ",\n";
+
+      // The same value as validatestring_result gives for the element.
+      if (! validatestring_is_row (strarray(i)))
+        types_code += "  0,\n";
+      else if (strarray(i).is_dq_string ())
+        types_code += "  '\"',\n";
+      else
+        types_code += "  '\\'',\n";
+    }
+
+  std::string match_code;
+  validatestring_codegen_node (match_code, name, folded, order, 0,
+                               order.size (), 0, trie, 2);
+
+  std::string code
+    = validatestring_expand (validatestring_codegen_template,
+                             {{"@NAME@", name}, {"@N@", std::to_string (n)},
+                              {"@STRS@", strs_code}, {"@LENS@", lens_code},
+                              {"@TYPES@", types_code},
+                              {"@MATCH@", match_code}});
+
+  if (nargout > 0)
+    return ovl (code);
+
+  std::string file = name + ".cc";
+  std::ofstream os (file);
+  if (! os)
+    error ("validatestring_codegen: unable to open %s", file.c_str ());
+
+  os << code;
+
+  return ovl ();
+}
+
+octave_value_list
+validatestring_do_parse_options (const octave_value_list& args)
+{
+  octave_idx_type i;
+  octave_idx_type position = 0;
+
+  std::string funcname_buf;
+  std::string buf;
+  std::string msg;
+  Cell        names;
+
+  validatestring_context context;
+
+  std::shared_ptr<const validatestring_index> index;
+
+  int nargin = args.length ();
+
+  if (nargin < 3 || nargin > 5)
+    print_usage ();
+
+  const octave_value& ov_opts     = args(0);
+  const octave_value& ov_names    = args(1);
+  const octave_value& ov_defaults = args(2);
+
+  bool is_index = (ov_names.type_id ()
+                   == octave_validatestring_index::static_type_id ());
+
+  if (!ov_opts.iscell ())
+    {
+      error ("parse_options: ARGS must be a cell array");
+    }
+  else if (!is_index && ov_names.isempty ())
+    {
+      error ("parse_options: NAMES must be non-empty");
+    }
+  else if (!is_index && !ov_names.iscellstr ())
+    {
+      error ("parse_options: NAMES must be a cellstr");
+    }
+  else if (!ov_defaults.iscell ())
+    {
+      error ("parse_options: DEFAULTS must be a cell array");
+    }
+
+  if (nargin > 3)
+    {
+      const octave_value& ov_funcname = args(3);
+
+      if (!ov_funcname.is_string ()
+          || (!ov_funcname.isempty () && !validatestring_is_row (ov_funcname)))
+        error ("parse_options: FUNCNAME must be a single row vector");
+
+      if (!ov_funcname.isempty ())
+        context.funcname = validatestring_view (ov_funcname, funcname_buf);
+    }
+
+  if (nargin > 4)
+    {
+      position = args(4).xidx_type_value ("parse_options: POSITION must be "
+                                          "an integer");
+      if (position < 0)
+        error ("parse_options: POSITION must be >= 0");
+    }
+
+  if (is_index)
+    {
+      const octave_validatestring_index& compiled
+        = dynamic_cast<const octave_validatestring_index&>
+            (ov_names.get_rep ());
+
+      index = compiled.index ();
+      names = compiled.strarray ();
+    }
+  else
+    {
+      names = ov_names.cell_value ();
+      index = validatestring_cache_instance ().lookup
+                (names, validatestring_cache_budget (),
+                 validatestring_build_index ((ov_opts.numel () + 1) / 2,
+                                             names));
+    }
+
+  Cell defaults = ov_defaults.cell_value ();
+
+  if (defaults.numel () != names.numel ())
+    error ("parse_options: DEFAULTS must have one element for each of NAMES");
+
+  octave_scalar_map retval;
+
+  for (i = 0; i < names.numel (); i++)
+    retval.assign (names(i).string_value (), defaults(i));
+
+  Cell opts = ov_opts.cell_value ();
+  octave_idx_type nopts = opts.numel ();
+
+  validatestring_cell strs (names);
+
+  context.limit = Vvalidatestring_list_limit;
+
+  for (i = 0; i < nopts; i += 2)
+    {
+      const octave_value& elt = opts(i);
+
+      context.position = (position > 0 ? position + i : 0);
+
+      if (!elt.is_string () || !validatestring_is_row (elt))
+        error ("parse_options: %smust be a parameter name",
+               validatestring_errstr (context.funcname, "", "NAME",
+                                      context.position).c_str ());
+
+      std::string_view name = validatestring_view (elt, buf);
+
+      validatestring_match result
+        = validatestring_validate (name, strs, index.get (), &msg, context);
+
+      if (result < 0)
+        error ("%s", msg.c_str ());
+      else if (i + 1 == nopts)
+        error ("parse_options: %shas no value",
+               validatestring_errstr (context.funcname, "",
+                                      "'" + std::string (name) + "'",
+                                      context.position).c_str ());
+
+      retval.assign (std::string (strs(result)), opts(i+1));
+    }
+
+  return ovl (retval);
+}
@@ -0,0 +1,69 @@
+/*
+
+Copyright (C) 2018-2018 Gene Harvey
+
+This file is part of Octave.
+
+Octave is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Octave is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Octave; see the file COPYING.  If not, see
+<https://www.gnu.org/licenses/>.
+
+*/
+
+#if ! defined (octave_validatestring_octave_h)
+#define octave_validatestring_octave_h 1
+
+// Interpreter side of validatestring, shared by the oct-file
+// (validatestring.cc) and the built-in functions (validatestring.cc.static).
+// They only define the functions and their docstrings, and call the
+// validatestring_do_* functions declared here for everything else.
+
+#include "octave-config.h"
+
+#include "ovl.h"
+
+namespace octave
+{
+  class interpreter;
+}
+
+// Bodies of the functions of the same names.  validatestring_do_compile
+// registers the type of its result with INTERP the first time.
+
+extern octave_value_list
+validatestring_do_validatestring (const octave_value_list& args,
+                                  int nargout);
+
+extern octave_value_list
+validatestring_do_compile (octave::interpreter& interp,
+                           const octave_value_list& args);
+
+extern octave_value_list
+validatestring_do_cache_size (const octave_value_list& args, int nargout);
+
+extern octave_value_list
+validatestring_do_cache_clear (const octave_value_list& args);
+
+extern octave_value_list
+validatestring_do_list_limit (const octave_value_list& args, int nargout);
+
+extern octave_value_list
+validatestring_do_threads (const octave_value_list& args, int nargout);
+
+extern octave_value_list
+validatestring_do_codegen (const octave_value_list& args, int nargout);
+
+extern octave_value_list
+validatestring_do_parse_options (const octave_value_list& args);
+
+#endif
@@ -20,14 +20,27 @@ along with Octave; see the file COPYING.  If not, see
 
 */
 
-#include <octave/oct-string.h>
 #include <octave/oct.h>
+#include <octave/interpreter.h>
+
+#include "validatestring-octave.h"
+
+// PKG_ADD: autoload ("validatestring_compile", "validatestring.oct");
+// PKG_ADD: autoload ("validatestring_cache_size", "validatestring.oct");
+// PKG_ADD: autoload ("validatestring_cache_clear", "validatestring.oct");
+// PKG_ADD: autoload ("validatestring_list_limit", "validatestring.oct");
+// PKG_ADD: autoload ("validatestring_threads", "validatestring.oct");
+// PKG_ADD: autoload ("validatestring_codegen", "validatestring.oct");
+// PKG_ADD: autoload ("parse_options", "validatestring.oct");
 
 DEFUN_DLD (validatestring, args, nargout, "-*- texinfo -*-\n\
 @deftypefn  {} {@var{validstr} =} validatestring (@var{str}, @var{strarray})\n\
 @deftypefnx {} {@var{validstr} =} validatestring (@var{str}, @var{strarray}, @var{funcname})\n\
 @deftypefnx {} {@var{validstr} =} validatestring (@var{str}, @var{strarray}, @var{funcname}, @var{varname})\n\
 @deftypefnx {} {@var{validstr} =} validatestring (@dots{}, @var{position})\n\
+@deftypefnx {} {@var{validstrs} =} validatestring (@var{strs}, @dots{})\n\
+@deftypefnx {} {[@var{validstr}, @var{idx}] =} validatestring (@dots{})\n\
+@deftypefnx {} {[@var{validstr}, @var{idx}, @var{status}] =} validatestring (@dots{})\n\
 Verify that @var{str} is an element, or substring of an element, in\n\
 @var{strarray}.\n\
 \n\
@@ -46,6 +59,23 @@ The additional inputs @var{funcname}, @var{varname}, and @var{position}\n\
 are optional and will make any generated validation error message more\n\
 specific.\n\
 \n\
+If @var{str} is a cellstr, then each of its elements is validated and\n\
+@var{validstr} is a cellstr of the same size.  All invalid elements are\n\
+reported together in a single error.\n\
+\n\
+The optional second output @var{idx} is the index of @var{validstr} in\n\
+@var{strarray}, or an array of such indices the same size as @var{strs}.\n\
+\n\
+If the third output @var{status} is requested, no error is raised when\n\
+@var{str} is not valid.  @var{status} is 1 if @var{str} was validated, 0 if\n\
+it does not match any element of @var{strarray}, and -1 if the match is\n\
+ambiguous.  For an invalid @var{str}, @var{validstr} is empty and @var{idx}\n\
+is 0.  Errors for invalid arguments are still raised.\n\
+\n\
+@var{strarray} may also be an index created by\n\
+@code{validatestring_compile}, which is faster when the same\n\
+@var{strarray} is used for many validations.\n\
+\n\
 Examples:\n\
 @c Set example in small font to prevent overfull line\n\
 \n\
@@ -60,180 +90,247 @@ validatestring (\"b\", @{\"red\", \"green\", \"blue\", \"black\"@})\n\
 @end group\n\
 @end smallexample\n\
 \n\
-@seealso{strcmp, strcmpi, validateattributes, inputParser}\n\
+@seealso{validatestring_compile, validatestring_cache_size, strcmp,\n\
+strcmpi, validateattributes, inputParser}\n\
 @end deftypefn ")
 {
-  octave_idx_type    i;
-  std::string        errstr;
-  std::string        non_match_str;
-
-  octave_value       ov_str;
-  octave_value       ov_strarray;
-  octave_value       ov_funcname;
-  octave_value       ov_varname;
-
-  std::string        str;
-  Array<std::string> strarray;
-  std::string        funcname;
-  std::string        varname;
-
-  octave_idx_type        nstrs, nmatches;
-  Array<octave_idx_type> matches;
-
-  size_t          len, min_len;
-  octave_idx_type min_len_idx;
-
-  int             ncharin  = 0;
-  octave_idx_type nargin   = args.length ();
-  octave_idx_type position = 0;
-
-  if (nargin < 2 || nargin > 5)
-    print_usage ();
-
-  ov_str      = args(0);
-  ov_strarray = args(1);
-
-  for (i = 2; i < nargin; i++)
-    {
-      if (args(i).is_string ())
-        {
-          switch (ncharin)
-            {
-              case 0:
-                {
-                  ov_funcname = args(i);
-                  break;
-                }
-              case 1:
-                {
-                  ov_varname = args (i);
-                  break;
-                }
-              default:
-                error ("validatestring: invalid number of character inputs "
-                       "(3)");
-            }
-          ncharin++;
-        }
-    }
+  return validatestring_do_validatestring (args, nargout);
+}
 
-  if (nargin > 2 && args(nargin - 1).isnumeric ())
-    {
-      position = (args(nargin - 1).fix ()).idx_type_value ();
-    }
+DEFMETHOD_DLD (validatestring_compile, interp, args, , "-*- texinfo -*-\n\
+@deftypefn  {} {@var{index} =} validatestring_compile (@var{strarray})\n\
+@deftypefnx {} {@var{index} =} validatestring_compile (@var{strarray}, @var{kind})\n\
+Precompute a lookup index for use with @code{validatestring}.\n\
+\n\
+The result may be passed to @code{validatestring} in place of the cellstr\n\
+@var{strarray}.  The results and error messages are the same as for\n\
+@var{strarray} itself.  @var{kind} selects the type of index:\n\
+\n\
+@table @asis\n\
+@item @qcode{\"trie\"} (default)\n\
+A trie of the elements of @var{strarray}.  Each lookup takes time\n\
+proportional to the length of the string being validated rather than to the\n\
+number of elements in @var{strarray}.\n\
+\n\
+@item @qcode{\"sorted\"}\n\
+A sorted copy of @var{strarray}, searched by binary search.  Each lookup\n\
+takes time proportional to the logarithm of the number of elements, and the\n\
+index is smaller than a trie.\n\
+\n\
+@item @qcode{\"double-array\"}\n\
+A trie stored as two arrays, with the rest of each element kept as a string\n\
+once no other element shares its prefix.  Lookups are as fast as with\n\
+@qcode{\"trie\"}, and the index is smaller than with @qcode{\"sorted\"}.\n\
+This is the best choice for vocabularies of millions of strings.\n\
+\n\
+@item @qcode{\"front-coded\"}\n\
+A sorted copy of @var{strarray} in which each element is stored as the\n\
+length of the prefix it shares with the previous one and the characters\n\
+that follow, except for the first of every block of 16 elements.  Lookups\n\
+take a few microseconds for millions of elements.  This is the smallest\n\
+index when many elements share long prefixes, such as\n\
+@qcode{\"Parameter_Group_Alpha_1\"}, @qcode{\"Parameter_Group_Alpha_2\"},\n\
+@dots{}\n\
+\n\
+@item @qcode{\"bit-sliced\"}\n\
+For each of the first 4 character positions and each character, the set of\n\
+elements of @var{strarray} that have that character there, stored as bits.\n\
+A lookup combines the sets for the characters of the string being\n\
+validated, 64 elements at a time, and strings equal to an element are found\n\
+by a hash table.  This is the fastest index for strings of up to 4\n\
+characters validated against lists of thousands of elements.\n\
+\n\
+@item @qcode{\"packed\"}\n\
+A copy of @var{strarray} with the first 8 characters of every element\n\
+packed into one array.  Each lookup is still a linear search, but most\n\
+elements are rejected from that array alone, several at a time, without\n\
+reading the elements themselves.  A string equal to an element is found\n\
+by a hash table without any search.  The index takes little more memory\n\
+than @var{strarray}.\n\
+@end table\n\
+\n\
+@code{whos} reports the memory used by the index and by the copy of\n\
+@var{strarray} that it keeps for its results and error messages.\n\
+\n\
+Example:\n\
+\n\
+@example\n\
+@group\n\
+colors = validatestring_compile (@{\"red\", \"green\", \"blue\"@});\n\
+validatestring (\"r\", colors)\n\
+@result{} \"red\"\n\
+@end group\n\
+@end example\n\
+\n\
+@seealso{validatestring}\n\
+@end deftypefn ")
+{
+  octave_value_list retval = validatestring_do_compile (interp, args);
 
-  if (!ov_str.is_string ())
-    {
-      error ("validatestring: STR must be a character string");
-    }
-  else if (ov_str.ndims () != 2 || ov_str.dims ()(0) != 1)
-    {
-      error ("validatestring: STR must be a single row vector");
-    }
-  else if (ov_strarray.isempty ())
-    {
-      error ("validatestring: STRARRAY must be non-empty");
-    }
-  else if (!ov_strarray.iscellstr ())
-    {
-      error ("validatestring: STRARRAY must be a cellstr");
-    }
-  else if (!ov_funcname.isempty ()
-           && (ov_funcname.ndims () != 2 || ov_funcname.dims ()(0) != 1))
-    {
-      error ("validatestring: FUNCNAME must be a single row vector");
-    }
-  else if (!ov_varname.isempty ()
-           && (ov_varname.ndims () != 2 || ov_varname.dims ()(0) != 1))
-    {
-      error ("validatestring: VARNAME must be a single row vector");
-    }
-  else if (position < 0)
-    {
-      error ("validatestring: POSITION must be >= 0");
-    }
+  // The type of the index is defined in this oct-file.
+  interp.mlock ();
 
-  str      = ov_str.string_value ();
-  strarray = ov_strarray.cellstr_value ();
+  return retval;
+}
 
-  if (!ov_funcname.isempty ())
-    {
-      funcname = ov_funcname.string_value ();
-      errstr   = funcname + ": ";
-    }
+DEFUN_DLD (validatestring_cache_size, args, nargout, "-*- texinfo -*-\n\
+@deftypefn  {} {@var{val} =} validatestring_cache_size ()\n\
+@deftypefnx {} {@var{old_val} =} validatestring_cache_size (@var{new_val})\n\
+@deftypefnx {} {@var{old_val} =} validatestring_cache_size (@var{new_val}, \"local\")\n\
+Query or set the memory, in bytes, that @code{validatestring} may use for\n\
+the lookup indices of the cellstr arguments it remembers.\n\
+\n\
+When the same cellstr @var{strarray} is passed to @code{validatestring}\n\
+repeatedly, the index that @code{validatestring_compile} would build for it\n\
+with @qcode{\"sorted\"} is created the second time and reused.  It takes\n\
+about 32 bytes per element in addition to the characters.  The least\n\
+recently used indices are dropped when the limit is exceeded, and a\n\
+@var{strarray} whose index alone would exceed it is never cached.  The\n\
+default is 64 MiB, and a value of 0 disables the cache.\n\
+\n\
+When called from inside a function with the @qcode{\"local\"} option, the\n\
+variable is changed locally for the function and any subroutines it calls.\n\
+The original variable value is restored when exiting the function.\n\
+@seealso{validatestring_cache_clear, validatestring, validatestring_compile}\n\
+@end deftypefn ")
+{
+  return validatestring_do_cache_size (args, nargout);
+}
 
-  if (!ov_varname.isempty ())
-    {
-      varname =  ov_varname.string_value ();
-      errstr  += varname + " ";
-    }
-  else
-    {
-      errstr += "'" + str + "' ";
-    }
+DEFUN_DLD (validatestring_cache_clear, args, , "-*- texinfo -*-\n\
+@deftypefn {} {} validatestring_cache_clear ()\n\
+Discard all lookup indices cached by @code{validatestring}.\n\
+@seealso{validatestring_cache_size, validatestring}\n\
+@end deftypefn ")
+{
+  return validatestring_do_cache_clear (args);
+}
 
-  if (position > 0)
-    {
-      errstr += "(argument #" + std::to_string (position) + ") ";
-    }
+DEFUN_DLD (validatestring_list_limit, args, nargout, "-*- texinfo -*-\n\
+@deftypefn  {} {@var{val} =} validatestring_list_limit ()\n\
+@deftypefnx {} {@var{old_val} =} validatestring_list_limit (@var{new_val})\n\
+@deftypefnx {} {@var{old_val} =} validatestring_list_limit (@var{new_val}, \"local\")\n\
+Query or set the maximum number of elements listed in the error messages\n\
+of @code{validatestring}.\n\
+\n\
+Any further elements are summarized as @qcode{\"@dots{} and @var{n}\n\
+more\"}.  The same limit applies to the number of invalid elements\n\
+described for a cellstr @var{str}.  A value of 0 removes the limit.\n\
+\n\
+When called from inside a function with the @qcode{\"local\"} option, the\n\
+variable is changed locally for the function and any subroutines it calls.\n\
+The original variable value is restored when exiting the function.\n\
+@seealso{validatestring}\n\
+@end deftypefn ")
+{
+  return validatestring_do_list_limit (args, nargout);
+}
 
-  nstrs = strarray.numel ();
-  matches  = Array<octave_idx_type> (dim_vector (nstrs, 1));
-  nmatches = 0;
-  for (i = 0; i < nstrs; i++)
-    {
-      if (octave::string::strncmpi (str, strarray(i), str.length ()))
-        {
-          matches (nmatches) = i;
-          nmatches++;
-        }
-    }
+DEFUN_DLD (validatestring_threads, args, nargout, "-*- texinfo -*-\n\
+@deftypefn  {} {@var{val} =} validatestring_threads ()\n\
+@deftypefnx {} {@var{old_val} =} validatestring_threads (@var{new_val})\n\
+@deftypefnx {} {@var{old_val} =} validatestring_threads (@var{new_val}, \"local\")\n\
+Query or set the maximum number of threads used by @code{validatestring}.\n\
+\n\
+A cellstr @var{strarray} with hundreds of thousands of elements is split\n\
+among several threads when it has to be searched element by element.  Each\n\
+thread is given at least 65536 elements, so smaller arrays are always\n\
+searched by a single thread.  Likewise, the elements of a cellstr @var{str}\n\
+are validated by several threads when there are more than 16384 of them.\n\
+The results and error messages do not depend on the number of threads.\n\
+A value of 0, the default, allows one thread per processor core, and a\n\
+value of 1 disables threads.\n\
+\n\
+When called from inside a function with the @qcode{\"local\"} option, the\n\
+variable is changed locally for the function and any subroutines it calls.\n\
+The original variable value is restored when exiting the function.\n\
+@seealso{validatestring, validatestring_cache_size}\n\
+@end deftypefn ")
+{
+  return validatestring_do_threads (args, nargout);
+}
 
-  if (nmatches == 0)
-    {
-      non_match_str = strarray(0);
-      for (i = 1; i < nstrs; i++)
-        {
-          non_match_str += ", " + strarray(i);
-        }
-      error ("validatestring: %sdoes not match any of \n%s", errstr.c_str (),
-             non_match_str.c_str ());
-    }
-  else if (nmatches == 1)
-    {
-      return octave_value (strarray(matches(0)));
-    }
-  else
-    {
-      min_len = strarray(matches(0)).length ();
-      min_len_idx = 0;
-      for (i = 1; i < nmatches; i++)
-        {
-          len = strarray(matches(i)).length ();
-          if (len < min_len)
-            {
-              min_len = len;
-              min_len_idx = i;
-            }
-        }
+DEFUN_DLD (validatestring_codegen, args, nargout, "-*- texinfo -*-\n\
+@deftypefn  {} {} validatestring_codegen (@var{strarray}, @var{name})\n\
+@deftypefnx {} {@var{code} =} validatestring_codegen (@var{strarray}, @var{name})\n\
+Generate the C++ source of an oct-file that validates strings against the\n\
+fixed list @var{strarray}.\n\
+\n\
+The oct-file defines the function @var{name}, and\n\
+@code{@var{name} (@var{str}, @dots{})} gives the same outputs and errors as\n\
+@code{validatestring (@var{str}, @var{strarray}, @dots{})}.  The elements\n\
+of @var{strarray}, and the result for every prefix of them, are written\n\
+into the code as nested @code{switch} statements on the characters of\n\
+@var{str}, so nothing is searched or built when the function runs.  Calls\n\
+that do not return a match, and cellstr @var{str}, are passed on to\n\
+@code{validatestring}.\n\
+\n\
+With no output the code is written to the file @file{@var{name}.cc} in the\n\
+current directory, and otherwise it is returned as a string.  It is\n\
+compiled with @code{mkoctfile}.\n\
+\n\
+Example:\n\
+\n\
+@example\n\
+@group\n\
+validatestring_codegen (@{\"linear\", \"nearest\", \"cubic\"@}, \"interp_method\");\n\
+mkoctfile interp_method.cc\n\
+interp_method (\"lin\")\n\
+@result{} \"linear\"\n\
+@end group\n\
+@end example\n\
+\n\
+@seealso{validatestring, validatestring_compile, mkoctfile}\n\
+@end deftypefn ")
+{
+  return validatestring_do_codegen (args, nargout);
+}
 
-      for (i = 0; i < nmatches; i++)
-        {
-          if (i != min_len_idx
-              && ! octave::string::strncmpi (strarray(matches(min_len_idx)),
-                                             strarray(matches(i)), min_len))
-            {
-              non_match_str = strarray (matches (0));
-              for (i = 1; i < nmatches; i++)
-                {
-                  non_match_str += ", " + strarray (matches (i));
-                }
-              error ("validatestring: %sallows multiple unique matches:\n%s",
-                  errstr.c_str (), non_match_str.c_str ());
-            }
-        }
-      return octave_value (strarray(matches(min_len_idx)));
-    }
+DEFUN_DLD (parse_options, args, , "-*- texinfo -*-\n\
+@deftypefn  {} {@var{opts} =} parse_options (@var{args}, @var{names}, @var{defaults})\n\
+@deftypefnx {} {@var{opts} =} parse_options (@dots{}, @var{funcname})\n\
+@deftypefnx {} {@var{opts} =} parse_options (@dots{}, @var{funcname}, @var{position})\n\
+Parse the name/value pairs in the cell array @var{args}.\n\
+\n\
+Each name in @var{args} is validated against the cellstr @var{names} as by\n\
+@code{validatestring}, so it may be abbreviated and its case does not\n\
+matter.  @var{names} may also be an index from\n\
+@code{validatestring_compile}.  The result is a struct with a field for\n\
+each element of @var{names}.  The field is set to the value that follows\n\
+the last name in @var{args} validated to it, or else to the element of the\n\
+cell array @var{defaults} at the same position.\n\
+\n\
+All the names are validated in a single call, which avoids calling\n\
+@code{validatestring} once for each of them.  An invalid name raises the\n\
+same error as\n\
+@code{validatestring (@var{name}, @var{names}, @var{funcname}, @var{pos})}.\n\
+@var{position} is the position of the first element of @var{args} among the\n\
+arguments of @var{funcname}, and @var{pos} is counted from it.  If\n\
+@var{position} is 0, the default, positions are left out of the messages.\n\
+\n\
+Example:\n\
+\n\
+@example\n\
+@group\n\
+names = @{\"Method\", \"Span\"@};\n\
+opts = parse_options (@{\"span\", 9@}, names, @{\"moving\", 5@})\n\
+@result{} opts =\n\
+\n\
+    scalar structure containing the fields:\n\
+\n\
+      Method = moving\n\
+      Span = 9\n\
+\n\
+parse_options (@{\"spn\", 9@}, names, @{\"moving\", 5@}, \"smooth\", 2)\n\
+@print{} error: validatestring: smooth: 'spn' (argument #2) does not match any of\n\
+Method, Span\n\
+@end group\n\
+@end example\n\
+\n\
+@seealso{validatestring, validatestring_compile, inputParser}\n\
+@end deftypefn ")
+{
+  return validatestring_do_parse_options (args);
 }
 
 /*
@@ -251,6 +348,272 @@ validatestring (\"b\", @{\"red\", \"green\", \"blue\", \"black\"@})\n\
 %!error <DUMMY_TEST: DUMMY_VAR \(argument #5\) does> validatestring ("xyz", strarray, "DUMMY_TEST", "DUMMY_VAR", 5)
 %!error <'abc' allows multiple unique matches> validatestring ("abc", strarray)
 
+%!assert (validatestring ({"r", "GR"; "blu", "red"}, {"red", "green", "blue"}),
+%!        {"red", "green"; "blue", "red"})
+%!assert (validatestring ({"oct"}, {"octave" "Oct" "octopus" "octaves"}), {"Oct"})
+%!assert (validatestring (cell (0, 3), {"red"}), cell (0, 3))
+%!test
+%! [str, idx] = validatestring ("octa", {"octave" "Oct" "octopus" "octaves"});
+%! assert (str, "octave");
+%! assert (idx, 1);
+%! [str, idx] = validatestring ("oct", {"octave" "Oct" "octopus" "octaves"});
+%! assert (idx, 2);
+%! [str, idx] = validatestring ({"g"; "R"; "blu"}, {"red", "green", "blue"});
+%! assert (str, {"green"; "red"; "blue"});
+%! assert (idx, [2; 1; 3]);
+%! [str, idx] = validatestring ("b", validatestring_compile ({"red", "blue"}));
+%! assert (idx, 2);
+%! [str, idx] = validatestring (cell (0, 2), {"red"});
+%! assert (size (idx), [0, 2]);
+%!test
+%! strarray = {"red", "green", "blue", "black"};
+%! [str, idx, status] = validatestring ("gr", strarray);
+%! assert ({str, idx, status}, {"green", 2, 1});
+%! [str, idx, status] = validatestring ("xyz", strarray);
+%! assert ({str, idx, status}, {"", 0, 0});
+%! [str, idx, status] = validatestring ("bl", strarray, "FUNC", "VAR", 2);
+%! assert ({str, idx, status}, {"", 0, -1});
+%! [str, idx, status] = validatestring ({"R", "x"; "bl", "blu"}, strarray);
+%! assert (str, {"red", ""; "", "blue"});
+%! assert (idx, [1, 0; 0, 3]);
+%! assert (status, [1, 0; -1, 1]);
+%!error <STR must be a character string> [~, ~, status] = validatestring (1, {"xyz"})
+%!test
+%! old = validatestring_list_limit (2);
+%! unwind_protect
+%!   strarray = {"a1", "b", "a2", "c", "a3", "d"};
+%!   fail ('validatestring ("xyz", strarray)',
+%!         "any of \na1, b, \\.\\.\\. and 4 more$");
+%!   fail ('validatestring ("a", strarray)',
+%!         "multiple unique matches:\na1, a2, \\.\\.\\. and 1 more$");
+%!   fail ('validatestring ({"x", "y", "z"}, strarray)',
+%!         "has 3 invalid elements:.*\n  \\.\\.\\. and 1 more\nvalid values are:\na1, b, \\.\\.\\. and 4 more$");
+%!   validatestring_list_limit (0);
+%!   fail ('validatestring ("xyz", strarray)', "any of \na1, b, a2, c, a3, d$");
+%! unwind_protect_cleanup
+%!   validatestring_list_limit (old);
+%! end_unwind_protect
+%!assert (is_dq_string (validatestring ("r", {"red"})))
+%!assert (is_sq_string (validatestring ("r", {'red'})))
+%!assert (is_sq_string (validatestring ({"r"}, {'red'}){1}))
+%!assert (validatestring ({"d", "abc1"}, validatestring_compile ({"abc1" "def"})),
+%!        {"def", "abc1"})
+%!error <STR has 2 invalid elements:\n  'xyz' \(element 2\) does not match any valid value\n  'b' \(element 3\) allows multiple unique matches: blue, black\nvalid values are:\nred, blue, black>
+%! validatestring ({"r", "xyz", "b"}, {"red", "blue", "black"});
+%!error <DUMMY_TEST: DUMMY_VAR \(argument #3\) has 1 invalid element:\n  'b' \(element 1\) allows>
+%! validatestring ({"b"}, {"blue", "black"}, "DUMMY_TEST", "DUMMY_VAR", 3);
+%!error <has 12 invalid elements:.*\n  ... and 2 more\n>
+%! validatestring (repmat ({"x"}, 1, 12), {"red"});
+%!error <STR\{2\} must be a single row vector> validatestring ({"r", ""}, {"red"})
+
+%!test
+%! index = validatestring_compile ({"octave" "Oct" "octopus" "octaves"});
+%! assert (validatestring ("octave", index), "octave");
+%! assert (validatestring ("oct", index), "Oct");
+%! assert (validatestring ("OCTA", index), "octave");
+%! assert (validatestring ("octo", index), "octopus");
+%!test
+%! index = validatestring_compile ({"abc1" "def" "ABC1" "abc2"});
+%! assert (validatestring ("d", index), "def");
+%! assert (validatestring ("abc1", index), "abc1");
+%!error <'xyz' does not match any of \nabc1, def, abc2> validatestring ("xyz", validatestring_compile ({"abc1" "def" "abc2"}))
+%!error <DUMMY_TEST: DUMMY_VAR \(argument #5\) does> validatestring ("xyz", validatestring_compile ({"abc1" "def"}), "DUMMY_TEST", "DUMMY_VAR", 5)
+%!error <'abc' allows multiple unique matches:\nabc1, abc2> validatestring ("abc", validatestring_compile ({"abc1" "def" "abc2"}))
+
+## Every kind of index gives the same results as a scan of STRARRAY.  The
+## list is long enough for the front-coded index to have several blocks and
+## for the bit-sliced and packed indices to use several 64-bit words, and
+## prefixes such as "param_0" are shared across them.
+%!test
+%! params = arrayfun (@(k) sprintf ("param_%03d", k), 1:90,
+%!                    "uniformoutput", false);
+%! groups = arrayfun (@(k) sprintf ("Param_Group_%d_len", k), 1:20,
+%!                    "uniformoutput", false);
+%! strarray = [{"octave" "Oct" "octopus" "octaves" "abc1" "ABC1" "abc2" "x"},
+%!             params, groups, {"PARAM_050", "zeta", ""}];
+%! queries = {"", "oct", "OCTA", "octo", "octaves", "octopuses", "abc", ...
+%!            "abc1", "x", "X", "y", "p", "param_", "param_0", "param_01", ...
+%!            "PARAM_045", "param_05", "param_050", "param_09", ...
+%!            "param_090", "param_0901", "param_1", "param_g", ...
+%!            "param_group_1", "param_group_1_", "Param_Group_20_len", ...
+%!            "z", "ZETA", "zetas"};
+%! n = numel (queries);
+%! str = cell (1, n);
+%! [idx, status] = deal (zeros (1, n));
+%! old_size = validatestring_cache_size (0);
+%! unwind_protect
+%!   for i = 1:n
+%!     [str{i}, idx(i), status(i)] = validatestring (queries{i}, strarray);
+%!   endfor
+%!   kinds = {"trie", "sorted", "double-array", "front-coded", ...
+%!            "bit-sliced", "packed"};
+%!   for k = 1:numel (kinds)
+%!     index = validatestring_compile (strarray, kinds{k});
+%!     [str_k, idx_k, status_k] = validatestring (queries, index);
+%!     assert ({kinds{k}, str_k, idx_k, status_k},
+%!             {kinds{k}, str, idx, status});
+%!     for i = 1:n
+%!       [s, i_k, st] = validatestring (queries{i}, index);
+%!       assert ({kinds{k}, queries{i}, s, i_k, st},
+%!               {kinds{k}, queries{i}, str{i}, idx(i), status(i)});
+%!     endfor
+%!     s = whos ("index");
+%!     assert (s.bytes > sum (cellfun ("numel", strarray)));
+%!   endfor
+%! unwind_protect_cleanup
+%!   validatestring_cache_size (old_size);
+%! end_unwind_protect
+%!error <'abc' allows multiple unique matches:\nabc1, ABC1, abc2> validatestring ("abc", validatestring_compile ({"abc1" "ABC1" "abc2"}, "sorted"))
+
+%!test
+%! old = validatestring_cache_size (1000);
+%! unwind_protect
+%!   validatestring_cache_clear ();
+%!   strarray = {"red", "green", "blue", "black"};
+%!   for i = 1:3
+%!     assert (validatestring ("R", strarray), "red");
+%!     assert (validatestring ("blu", {"red", "green", "blue", "black"}), "blue");
+%!     assert (validatestring ("gr", {"green"; "greenish"}), "green");
+%!     fail ('validatestring ("bl", strarray)', "allows multiple unique matches");
+%!   endfor
+%!   strarray{3} = "Teal";
+%!   assert (validatestring ("t", strarray), "Teal");
+%!   assert (validatestring_cache_size (), 1000);
+%!   ## Too small for any index, so nothing is cached.
+%!   validatestring_cache_size (100);
+%!   for i = 1:3
+%!     assert (validatestring ("g", strarray), "green");
+%!     assert (validatestring ({"g", "T"}, strarray), {"green", "Teal"});
+%!   endfor
+%!   validatestring_cache_size (0);
+%!   assert (validatestring ("g", strarray), "green");
+%! unwind_protect_cleanup
+%!   validatestring_cache_size (old);
+%! end_unwind_protect
+
+%!test
+%! old_threads = validatestring_threads (4);
+%! old_size = validatestring_cache_size (0);
+%! unwind_protect
+%!   strarray = [{"abc1"}, strtrim(cellstr (num2str ((1:300000).'))).', {"ABC2"}];
+%!   assert (validatestring ("29999", strarray), "29999");
+%!   [str, idx] = validatestring ("abc2", strarray);
+%!   assert ({str, idx}, {"ABC2", 300002});
+%!   fail ('validatestring ("abc", strarray)',
+%!         "multiple unique matches:\nabc1, ABC2$");
+%!   fail ('validatestring ("x", strarray)', "does not match any");
+%!   assert (validatestring ({"29999"; "abc2"}, strarray), {"29999"; "ABC2"});
+%!   strs = repmat ({"1234", "AbC", "x", "abc2", "1"}, 1, 8000);
+%!   [str, idx, status] = validatestring (strs, strarray);
+%!   assert (str(1:5), {"1234", "", "", "ABC2", "1"});
+%!   assert (idx(1:5), [1235, 0, 0, 300002, 2]);
+%!   assert (status(1:5), [1, -1, 0, 1, 1]);
+%!   validatestring_threads (1);
+%!   assert (validatestring ("29999", strarray), "29999");
+%!   [str1, idx1, status1] = validatestring (strs, strarray);
+%!   assert ({str1, idx1, status1}, {str, idx, status});
+%! unwind_protect_cleanup
+%!   validatestring_threads (old_threads);
+%!   validatestring_cache_size (old_size);
+%! end_unwind_protect
+
+## Test that the oct-file from validatestring_codegen agrees with
+## validatestring, which it calls for anything but a match
+%!test
+%! strarray = {"octave", "Oct", "octopus", "octaves", "OCTAVE", "lin", ...
+%!             "linear", "linearity", "a\"b\\c", "x@N@y", "", 'quoted', ...
+%!             ''};
+%! code = validatestring_codegen (strarray, "vs_codegen_test");
+%! assert (! isempty (strfind (code, "DEFUN_DLD (vs_codegen_test,")));
+%! olddir = pwd ();
+%! tmpdir = tempname ();
+%! mkdir (tmpdir);
+%! unwind_protect
+%!   cd (tmpdir);
+%!   validatestring_codegen (strarray, "vs_codegen_test");
+%!   assert (fileread ("vs_codegen_test.cc"), code);
+%!   mkoctfile ("vs_codegen_test.cc");
+%!   addpath (tmpdir);
+%!   queries = {"", "o", "oc", "OCT", "octa", "Octave", "octaves", "octo", ...
+%!              "octopuses", "l", "li", "LIN", "line", "lineari", ...
+%!              "lineary", "a", "A\"B", "a\"b\\c", "x@n", "x@N@Y", "z", ...
+%!              "q", "QUOTED"};
+%!   for i = 1:numel (queries)
+%!     [s1, i1, st1] = vs_codegen_test (queries{i});
+%!     [s2, i2, st2] = validatestring (queries{i}, strarray);
+%!     assert ({s1, i1, st1}, {s2, i2, st2});
+%!     assert ({size(s1), is_dq_string(s1)}, {size(s2), is_dq_string(s2)});
+%!     msg1 = msg2 = "";
+%!     try
+%!       vs_codegen_test (queries{i}, "FUNC", "VAR", 3);
+%!     catch err
+%!       msg1 = err.message;
+%!     end_try_catch
+%!     try
+%!       validatestring (queries{i}, strarray, "FUNC", "VAR", 3);
+%!     catch err
+%!       msg2 = err.message;
+%!     end_try_catch
+%!     assert (msg1, msg2);
+%!   endfor
+%!   [s1, i1, st1] = vs_codegen_test (queries, "FUNC");
+%!   [s2, i2, st2] = validatestring (queries, strarray, "FUNC");
+%!   assert ({s1, i1, st1}, {s2, i2, st2});
+%!   assert (vs_codegen_test ("LINEAR", "", "", 0), "linear");
+%!   fail ('vs_codegen_test ("lin", "3", "4", "5")',
+%!         "invalid number of character inputs");
+%!   fail ('vs_codegen_test ("lin", "F", "V", -1)', "POSITION must be >= 0");
+%! unwind_protect_cleanup
+%!   clear vs_codegen_test;
+%!   rmpath (tmpdir);
+%!   cd (olddir);
+%!   confirm_recursive_rmdir (false, "local");
+%!   rmdir (tmpdir, "s");
+%! end_unwind_protect
+
+## Test parse_options
+%!shared names, defaults
+%! names = {"Method", "Span", "SpanMax", "Display"};
+%! defaults = {"moving", 5, Inf, false};
+%!assert (parse_options ({}, names, defaults),
+%!        struct ("Method", "moving", "Span", 5, "SpanMax", Inf,
+%!                "Display", false))
+%!assert (parse_options ({"span", 9, "METH", "lowess"}, names, defaults),
+%!        struct ("Method", "lowess", "Span", 9, "SpanMax", Inf,
+%!                "Display", false))
+%!assert (parse_options ({"d", true, "spanm", 3, "Display", 0}, names,
+%!                       defaults),
+%!        struct ("Method", "moving", "Span", 5, "SpanMax", 3, "Display", 0))
+%!assert (parse_options ({"m", {1, 2}}, validatestring_compile (names),
+%!                       defaults).Method, {1, 2})
+%!test
+%! for args = {{"x", 1}, {"s", 1}, {"method", 1, "dis", 2, "spn", 3}}
+%!   msg1 = msg2 = "";
+%!   try
+%!     parse_options (args{1}, names, defaults, "smooth", 2);
+%!   catch err
+%!     msg1 = err.message;
+%!   end_try_catch
+%!   for i = 1:2:numel (args{1})
+%!     try
+%!       validatestring (args{1}{i}, names, "smooth", 2 + i - 1);
+%!     catch err
+%!       msg2 = err.message;
+%!       break;
+%!     end_try_catch
+%!   endfor
+%!   assert (msg1, msg2);
+%! endfor
+%!error <validatestring: 'x' does not match any of \nMethod, Span, SpanMax, Display$>
+%! parse_options ({"x", 1}, names, defaults)
+%!error <validatestring: f: 'li' \(argument #4\) allows multiple unique matches:\nLineStyle, LineWidth$>
+%! parse_options ({"m", 1, "li", 2}, {"Marker", "LineStyle", "LineWidth"},
+%!                {"none", "-", 0.5}, "f", 2)
+%!error <parse_options: f: 'span' \(argument #5\) has no value>
+%! parse_options ({"m", 1, "span"}, names, defaults, "f", 3)
+%!error <parse_options: f: NAME \(argument #3\) must be a parameter name>
+%! parse_options ({"m", 1, 2, 3}, names, defaults, "f", 1)
+
 ## Test input validation
 %!error validatestring ("xyz")
 %!error validatestring ("xyz", {"xyz"}, "3", "4", 5, 6)
@@ -261,4 +624,32 @@ validatestring (\"b\", @{\"red\", \"green\", \"blue\", \"black\"@})\n\
 %!error <FUNCNAME must be a single row vector> validatestring ("xyz", {"xyz"}, "33".', "4", 5)
 %!error <VARNAME must be a single row vector> validatestring ("xyz", {"xyz"}, "3", "44".', 5)
 %!error <POSITION must be> validatestring ("xyz", {"xyz"}, "3", "4", -5)
+%!error validatestring_compile ()
+%!error <STRARRAY must be non-empty> validatestring_compile ({})
+%!error <STRARRAY must be a cellstr> validatestring_compile ("xyz")
+%!error <unknown index KIND 'hash'> validatestring_compile ({"xyz"}, "hash")
+%!error <KIND must be a string> validatestring_compile ({"xyz"}, 1)
+%!error validatestring_cache_size (-1)
+%!error validatestring_cache_clear (1)
+%!error validatestring_list_limit (-1)
+%!error validatestring_threads (-1)
+%!error validatestring_codegen ({"xyz"})
+%!error <STRARRAY must be non-empty> validatestring_codegen ({}, "f")
+%!error <STRARRAY must be a cellstr> validatestring_codegen ("xyz", "f")
+%!error <NAME must be a string> validatestring_codegen ({"xyz"}, 1)
+%!error <NAME must be a valid function name> validatestring_codegen ({"xyz"}, "1f")
+%!error <NAME must be a valid function name> validatestring_codegen ({"xyz"}, "f.cc")
+%!error <single row vectors> validatestring_codegen ({["ab"; "cd"]}, "f")
+%!error <NAME must not be validatestring>
+%! validatestring_codegen ({"xyz"}, "validatestring")
+%!error parse_options ({}, {"a"})
+%!error parse_options ({}, {"a"}, {1}, "f", 1, 2)
+%!error <ARGS must be a cell array> parse_options ("a", {"a"}, {1})
+%!error <NAMES must be non-empty> parse_options ({}, {}, {})
+%!error <NAMES must be a cellstr> parse_options ({}, "a", {1})
+%!error <DEFAULTS must be a cell array> parse_options ({}, {"a"}, 1)
+%!error <one element for each of NAMES> parse_options ({}, {"a", "b"}, {1})
+%!error <FUNCNAME must be a single row vector> parse_options ({}, {"a"}, {1}, 1)
+%!error <POSITION must be an integer> parse_options ({}, {"a"}, {1}, "f", 1.5)
+%!error <POSITION must be >= 0> parse_options ({}, {"a"}, {1}, "f", -1)
 */